@@ -9,8 +9,10 @@
 #include "settings.hpp"
 #include "transport.hpp"
 
+#include <cstddef>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace math::client {
@@ -18,12 +20,20 @@ namespace math::client {
 class Client {
 public:
     explicit Client(const Settings& settings)
-        : Client{make_input_reader(settings), make_transport(settings)} {}
+        : Client{make_input_reader(settings), make_transport(settings), settings.m_batch_size} {}
 
-    Client(input::ReaderPtr&& input_reader, TransportPtr&& transport)
-        : m_input_reader{std::move(input_reader)}, m_transport{std::move(transport)} {}
+    Client(input::ReaderPtr&& input_reader,
+           TransportPtr&& transport,
+           std::size_t batch_size = Settings::DEFAULT_BATCH_SIZE)
+        : m_input_reader{std::move(input_reader)},
+          m_transport{std::move(transport)},
+          m_batch_size{batch_size} {}
 
     void run() {
+        if (m_batch_size > 1) {
+            run_batches();
+            return;
+        }
         m_input_reader->for_each_input([this](const std::string& input) {
             m_transport->send_query(input,
                                     [](const std::string& reply) { std::cout << reply << '\n'; });
@@ -32,6 +42,44 @@ public:
     }
 
 private:
+    static constexpr char BATCH_SEPARATOR = ';';
+    static constexpr std::string_view BATCH_REPLY_SEPARATOR{"; "};
+
+    // Input lines are joined into a single query, and the server replies to
+    // them all at once.
+    void run_batches() {
+        std::string batch;
+        std::size_t numof_lines = 0;
+        m_input_reader->for_each_input([this, &batch, &numof_lines](const std::string& input) {
+            if (numof_lines != 0) {
+                batch += BATCH_SEPARATOR;
+            }
+            batch += input;
+            if (++numof_lines == m_batch_size) {
+                send_batch(batch);
+                batch.clear();
+                numof_lines = 0;
+            }
+            return true;
+        });
+        if (numof_lines != 0) {
+            send_batch(batch);
+        }
+    }
+
+    void send_batch(const std::string& batch) {
+        // One line per item, same as without batching.
+        m_transport->send_query(batch, [](const std::string& reply) {
+            std::string_view items{reply};
+            for (auto sep = items.find(BATCH_REPLY_SEPARATOR); sep != std::string_view::npos;
+                 sep = items.find(BATCH_REPLY_SEPARATOR)) {
+                std::cout << items.substr(0, sep) << '\n';
+                items.remove_prefix(sep + BATCH_REPLY_SEPARATOR.length());
+            }
+            std::cout << items << '\n';
+        });
+    }
+
     static input::ReaderPtr make_input_reader(const Settings& settings) {
         if (settings.input_from_string()) {
             return input::make_string_reader(settings.m_input);
@@ -43,11 +91,17 @@ private:
     }
 
     static TransportPtr make_transport(const Settings& settings) {
-        return make_blocking_network_transport(settings.m_host, settings.m_port);
+        if (settings.use_binary_protocol()) {
+            return make_binary_network_transport(settings.m_host, settings.m_port,
+                                                 settings.m_unix_socket);
+        }
+        return make_blocking_network_transport(settings.m_host, settings.m_port,
+                                               settings.m_unix_socket);
     }
 
     const input::ReaderPtr m_input_reader;
     TransportPtr m_transport;
+    const std::size_t m_batch_size;
 };
 
 } // namespace math::client
@@ -10,6 +10,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
+#include <cstddef>
 #include <exception>
 #include <iostream>
 #include <string>
@@ -18,13 +19,19 @@
 namespace math::client {
 
 struct Settings {
+    static constexpr std::size_t DEFAULT_BATCH_SIZE = 1;
+
     std::string m_input;
     std::string m_host;
     std::string m_port;
+    std::string m_unix_socket;
+    std::size_t m_batch_size;
     std::vector<std::string> m_files;
 
     bool exit_with_usage() const { return m_vm.count("help"); }
 
+    bool use_binary_protocol() const { return m_vm.count("binary"); }
+
     bool input_from_string() const { return m_vm.count("command"); }
 
     bool input_from_files() const { return !input_from_string() && !m_files.empty(); }
@@ -47,13 +54,21 @@ public:
         m_visible.add_options()(
             "port,p", po::value(&m_settings.m_port)->default_value(NetworkTransport::DEFAULT_PORT),
             "server port number");
+        m_visible.add_options()("unix-socket", po::value(&m_settings.m_unix_socket),
+                                "connect to a UNIX domain socket at this path instead");
+        m_visible.add_options()("binary,b", "use the binary protocol");
+        m_visible.add_options()(
+            "batch",
+            po::value(&m_settings.m_batch_size)->default_value(Settings::DEFAULT_BATCH_SIZE),
+            "number of input lines to send in a single request");
         m_hidden.add_options()("files", po::value<std::vector<std::string>>(&m_settings.m_files),
                                "shouldn't be visible");
         m_positional.add("files", -1);
     }
 
     static const char* get_short_description() {
-        return "[-h|--help] [-c|--command arg] [-H|--host] [-p|--port] [file...]";
+        return "[-h|--help] [-c|--command arg] [-H|--host] [-p|--port] [--unix-socket] "
+               "[-b|--binary] [--batch] [file...]";
     }
 
     Settings parse(int argc, char* argv[]) {
@@ -67,6 +82,7 @@ public:
             return m_settings;
         }
         po::notify(m_settings.m_vm);
+        validate();
         return m_settings;
     }
 
@@ -78,6 +94,14 @@ public:
     }
 
 private:
+    void validate() const {
+        namespace po = boost::program_options;
+
+        if (m_settings.m_batch_size == 0) {
+            throw po::validation_error{po::validation_error::invalid_option_value, "batch"};
+        }
+    }
+
     static std::string extract_filename(const std::string& path) {
         return boost::filesystem::path{path}.filename().string();
     }
@@ -7,12 +7,19 @@
 
 #include "error.hpp"
 
+#include <common/binary_protocol.hpp>
+#include <common/format.hpp>
+
 #include <boost/asio.hpp>
 #include <boost/system/system_error.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 
 namespace math::client {
 namespace transport {
@@ -35,22 +42,56 @@ public:
 
 using TransportPtr = std::unique_ptr<Transport>;
 
+// Connects to the server over TCP, unless the path to a UNIX domain socket
+// is given.
+
 class NetworkTransport : public Transport {
 public:
     static constexpr auto DEFAULT_PORT = "18000";
 
-    NetworkTransport(const std::string& host, const std::string& port)
-        : m_host{host}, m_port{port} {}
+    NetworkTransport(const std::string& host,
+                     const std::string& port,
+                     const std::string& unix_socket = {})
+        : m_host{host}, m_port{port}, m_unix_socket{unix_socket} {}
 
 protected:
+    using Socket = boost::asio::generic::stream_protocol::socket;
+
+    void connect(boost::asio::io_context& io_context, Socket& socket) const {
+        if (!m_unix_socket.empty()) {
+            connect_unix(io_context, socket);
+            return;
+        }
+        boost::asio::ip::tcp::resolver resolver{io_context};
+        boost::asio::ip::tcp::socket tcp_socket{io_context};
+        boost::asio::connect(tcp_socket, resolver.resolve(m_host, m_port));
+        socket = std::move(tcp_socket);
+    }
+
     const std::string m_host;
     const std::string m_port;
+    const std::string m_unix_socket;
+
+private:
+    void connect_unix(boost::asio::io_context& io_context, Socket& socket) const {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        boost::asio::local::stream_protocol::socket unix_socket{io_context};
+        unix_socket.connect(boost::asio::local::stream_protocol::endpoint{m_unix_socket});
+        socket = std::move(unix_socket);
+#else
+        (void)io_context;
+        (void)socket;
+        throw transport::Error{"UNIX domain sockets are not supported"};
+#endif
+    }
 };
 
 class BlockingNetworkTransport : public NetworkTransport {
 public:
-    BlockingNetworkTransport(const std::string& host, const std::string& port)
-        : NetworkTransport{host, port}, m_socket{m_io_context} {
+    BlockingNetworkTransport(const std::string& host,
+                             const std::string& port,
+                             const std::string& unix_socket = {})
+        : NetworkTransport{host, port, unix_socket}, m_socket{m_io_context} {
         try {
             connect();
         } catch (const boost::system::system_error& e) {
@@ -69,10 +110,7 @@ public:
     }
 
 private:
-    void connect() {
-        boost::asio::ip::tcp::resolver resolver{m_io_context};
-        boost::asio::connect(m_socket, resolver.resolve(m_host, m_port));
-    }
+    void connect() { NetworkTransport::connect(m_io_context, m_socket); }
 
     std::string send_query(const std::string& query) {
         write(query);
@@ -93,13 +131,125 @@ private:
     }
 
     boost::asio::io_context m_io_context;
-    boost::asio::ip::tcp::socket m_socket;
+    Socket m_socket;
     boost::asio::streambuf m_buffer;
 };
 
+// The server's binary protocol: the results come back as raw doubles, and are
+// formatted here, the same way the server does it.
+// See server/common/binary_protocol.hpp for the description.
+
+class BinaryNetworkTransport : public NetworkTransport {
+public:
+    BinaryNetworkTransport(const std::string& host,
+                           const std::string& port,
+                           const std::string& unix_socket = {})
+        : NetworkTransport{host, port, unix_socket}, m_socket{m_io_context} {
+        try {
+            connect();
+        } catch (const boost::system::system_error& e) {
+            throw transport::Error{e.what()};
+        }
+    }
+
+    void send_query(const std::string& query, const ProcessResult& on_reply) override {
+        std::string reply;
+        try {
+            reply = send_query(query);
+        } catch (const boost::system::system_error& e) {
+            throw transport::Error{e.what()};
+        }
+        on_reply(reply);
+    }
+
+private:
+    using Status = server::binary::Status;
+
+    // Same as the server's separator in text mode.
+    static constexpr auto BATCH_REPLY_SEPARATOR = "; ";
+
+    void connect() {
+        NetworkTransport::connect(m_io_context, m_socket);
+        boost::asio::write(m_socket, boost::asio::buffer(&server::binary::MAGIC, 1));
+    }
+
+    std::string send_query(const std::string& query) {
+        if (query.length() > std::numeric_limits<std::uint32_t>::max()) {
+            throw transport::Error{"query is too long"};
+        }
+        const auto id = m_next_id++;
+
+        std::string request;
+        server::binary::encode_header(request, {id, static_cast<std::uint32_t>(query.length())});
+        request += query;
+        boost::asio::write(m_socket, boost::asio::buffer(request));
+
+        return read_reply(id);
+    }
+
+    std::string read_reply(std::uint32_t id) {
+        if (read_u32() != id) {
+            throw transport::Error{"unexpected reply"};
+        }
+        const auto status = read_status();
+        if (status != Status::BATCH) {
+            return read_item(status);
+        }
+        const auto count = read_u32();
+        std::string result;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            if (i != 0) {
+                result += BATCH_REPLY_SEPARATOR;
+            }
+            result += read_item(read_status());
+        }
+        return result;
+    }
+
+    std::string read_item(Status status) {
+        switch (status) {
+            case Status::RESULT:
+                // The shortest representation, same as the server's default.
+                return server::format::number(read_double());
+
+            case Status::FAILURE:
+                return read_bytes(read_u32());
+
+            case Status::OK:
+                return "ok";
+
+            default:
+                throw transport::Error{"unexpected reply"};
+        }
+    }
+
+    std::string read_bytes(std::size_t n) {
+        std::string result(n, '\0');
+        boost::asio::read(m_socket, boost::asio::buffer(result));
+        return result;
+    }
+
+    std::uint32_t read_u32() { return server::binary::decode_u32(read_bytes(4).data()); }
+
+    Status read_status() { return static_cast<Status>(read_bytes(1)[0]); }
+
+    double read_double() { return server::binary::decode_double(read_bytes(8).data()); }
+
+    boost::asio::io_context m_io_context;
+    Socket m_socket;
+    std::uint32_t m_next_id = 0;
+};
+
 inline TransportPtr make_blocking_network_transport(const std::string& host,
-                                                    const std::string& port) {
-    return std::make_unique<BlockingNetworkTransport>(host, port);
+                                                    const std::string& port,
+                                                    const std::string& unix_socket = {}) {
+    return std::make_unique<BlockingNetworkTransport>(host, port, unix_socket);
+}
+
+inline TransportPtr make_binary_network_transport(const std::string& host,
+                                                  const std::string& port,
+                                                  const std::string& unix_socket = {}) {
+    return std::make_unique<BinaryNetworkTransport>(host, port, unix_socket);
 }
 
 } // namespace math::client
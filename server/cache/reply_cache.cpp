@@ -0,0 +1,193 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "reply_cache.hpp"
+
+#include <common/error.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace math::server {
+namespace {
+
+// A rough estimate of the memory used by an entry on top of the strings
+// (a list node, a hash table node, etc.).
+constexpr std::size_t ENTRY_OVERHEAD = 96;
+
+// Used to estimate the number of entries in a shard.
+constexpr std::size_t AVERAGE_ENTRY_SIZE = ENTRY_OVERHEAD + 64;
+
+constexpr bool is_whitespace(char c) {
+    // Same as the lexer.
+    return c == ' ' || ('\t' <= c && c <= '\r');
+}
+
+constexpr bool is_digit(char c) {
+    return '0' <= c && c <= '9';
+}
+
+constexpr bool is_exp(char c) {
+    return c == 'e' || c == 'E';
+}
+
+constexpr bool is_sign(char c) {
+    return c == '+' || c == '-';
+}
+
+constexpr bool is_letter(char c) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+// A part of a number or an identifier.
+constexpr bool is_word_char(char c) {
+    return is_digit(c) || c == '.' || c == '_' || is_letter(c);
+}
+
+// Whitespace between the end of the key and c would stop the lexer from
+// treating them as a single number (or identifier).
+bool is_significant(const std::string& key, char c) {
+    const auto prev = key.back();
+    if (is_word_char(prev) && is_word_char(c)) {
+        return true;
+    }
+    if (is_exp(prev) && is_sign(c)) {
+        return true;
+    }
+    // 1e+ 5
+    return is_sign(prev) && is_digit(c) && key.length() >= 2 && is_exp(key[key.length() - 2]);
+}
+
+} // namespace
+
+ReplyCache::Stats& ReplyCache::Stats::operator+=(const Stats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    insertions += other.insertions;
+    rejections += other.rejections;
+    evictions += other.evictions;
+    entries += other.entries;
+    bytes += other.bytes;
+    return *this;
+}
+
+ReplyCache::ReplyCache(std::size_t max_bytes, std::size_t numof_shards) {
+    if (numof_shards == 0) {
+        throw Error{"cache must have at least one shard"};
+    }
+    for (std::size_t i = 0; i < numof_shards; ++i) {
+        m_shards.emplace_back(std::make_unique<Shard>(max_bytes / numof_shards));
+    }
+}
+
+void ReplyCache::normalize(const std::string_view& input, std::string& key) {
+    key.clear();
+    bool space = false;
+    for (const auto c : input) {
+        if (is_whitespace(c)) {
+            space = !key.empty();
+            continue;
+        }
+        if (space && is_significant(key, c)) {
+            key += ' ';
+        }
+        space = false;
+        key += c;
+    }
+}
+
+void ReplyCache::insert(const std::string_view& key, const std::string_view& reply) {
+    const auto hash = hash_key(key);
+    auto& shard = get_shard(hash);
+    std::lock_guard<std::mutex> lck{shard.m_mtx};
+    shard.insert(key, reply, hash);
+}
+
+ReplyCache::Stats ReplyCache::get_stats() const {
+    Stats result;
+    for (const auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lck{shard->m_mtx};
+        result += shard->m_stats;
+    }
+    return result;
+}
+
+std::size_t ReplyCache::hash_key(const std::string_view& key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+ReplyCache::Shard& ReplyCache::get_shard(std::size_t hash) const {
+    // The low bits are used by the hash tables inside the shards.
+    return *m_shards[(hash >> 16) % m_shards.size()];
+}
+
+ReplyCache::Shard::Shard(std::size_t max_bytes)
+    : m_max_bytes{max_bytes}, m_sketch{max_bytes / AVERAGE_ENTRY_SIZE} {}
+
+const ReplyCache::Entry* ReplyCache::Shard::find(const std::string_view& key, std::size_t hash) {
+    m_sketch.increment(hash);
+    const auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &*it->second;
+}
+
+void ReplyCache::Shard::insert(const std::string_view& key,
+                               const std::string_view& reply,
+                               std::size_t hash) {
+    if (m_index.find(key) != m_index.end()) {
+        // Another session got there first.
+        return;
+    }
+    const auto bytes = key.length() + reply.length() + ENTRY_OVERHEAD;
+    if (!admit(bytes, hash)) {
+        ++m_stats.rejections;
+        return;
+    }
+    while (m_stats.bytes + bytes > m_max_bytes) {
+        evict();
+    }
+
+    m_entries.push_front({std::string{key}, std::string{reply}, bytes});
+    m_index.emplace(m_entries.front().m_key, m_entries.begin());
+    ++m_stats.insertions;
+    ++m_stats.entries;
+    m_stats.bytes += bytes;
+}
+
+bool ReplyCache::Shard::admit(std::size_t bytes, std::size_t hash) {
+    if (bytes > m_max_bytes) {
+        return false;
+    }
+    // The new entry must be more popular than every entry it would evict.
+    const auto frequency = m_sketch.estimate(hash);
+    auto available = m_max_bytes - m_stats.bytes;
+    for (auto it = m_entries.rbegin(); available < bytes; ++it) {
+        if (m_sketch.estimate(hash_key(it->m_key)) >= frequency) {
+            return false;
+        }
+        available += it->m_bytes;
+    }
+    return true;
+}
+
+void ReplyCache::Shard::evict() {
+    const auto& victim = m_entries.back();
+    m_index.erase(victim.m_key);
+    ++m_stats.evictions;
+    --m_stats.entries;
+    m_stats.bytes -= victim.m_bytes;
+    m_entries.pop_back();
+}
+
+} // namespace math::server
@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "sketch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace math::server {
+
+// A server-wide cache of replies, keyed by the (normalized) input.
+// It's split into shards, each with its own lock, so that the IO threads
+// rarely contend for the same one.
+// New entries are admitted according to TinyLFU: an entry evicts the least
+// recently used ones only if it's been requested more often than them.
+// This keeps one-off expressions from flushing out the popular ones.
+// Reference: https://arxiv.org/abs/1512.00727
+
+class ReplyCache {
+public:
+    struct Stats {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t insertions = 0;
+        // Entries that weren't admitted.
+        std::uint64_t rejections = 0;
+        std::uint64_t evictions = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+
+        Stats& operator+=(const Stats&);
+    };
+
+    static constexpr std::size_t DEFAULT_NUMOF_SHARDS = 16;
+
+    // The byte budget is split evenly between the shards.
+    explicit ReplyCache(std::size_t max_bytes, std::size_t numof_shards = DEFAULT_NUMOF_SHARDS);
+
+    // Strips the whitespace that doesn't affect how the input is tokenized.
+    // Replaces the contents of the key.
+    static void normalize(const std::string_view& input, std::string& key);
+
+    // The key must be normalized.
+    // If there's a hit, the reply is passed to the callback (which must not
+    // call back into the cache).
+    template <typename OnHit>
+    bool find(const std::string_view& key, OnHit&& on_hit) {
+        const auto hash = hash_key(key);
+        auto& shard = get_shard(hash);
+        std::lock_guard<std::mutex> lck{shard.m_mtx};
+        const auto entry = shard.find(key, hash);
+        if (entry == nullptr) {
+            return false;
+        }
+        on_hit(std::string_view{entry->m_reply});
+        return true;
+    }
+
+    void insert(const std::string_view& key, const std::string_view& reply);
+
+    Stats get_stats() const;
+
+private:
+    struct Entry {
+        std::string m_key;
+        std::string m_reply;
+        std::size_t m_bytes;
+    };
+
+    using Entries = std::list<Entry>;
+
+    class Shard {
+    public:
+        explicit Shard(std::size_t max_bytes);
+
+        const Entry* find(const std::string_view& key, std::size_t hash);
+        void insert(const std::string_view& key, const std::string_view& reply, std::size_t hash);
+
+        std::mutex m_mtx;
+        Stats m_stats;
+
+    private:
+        bool admit(std::size_t bytes, std::size_t hash);
+        void evict();
+
+        const std::size_t m_max_bytes;
+        FrequencySketch m_sketch;
+        // Most recently used first.
+        Entries m_entries;
+        std::unordered_map<std::string_view, Entries::iterator> m_index;
+    };
+
+    static std::size_t hash_key(const std::string_view& key);
+
+    Shard& get_shard(std::size_t hash) const;
+
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+} // namespace math::server
@@ -0,0 +1,90 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math::server {
+
+// Approximate access frequencies (a count-min sketch with small saturating
+// counters).
+// The counters are halved every once in a while, so that entries that used
+// to be popular don't stay in the cache forever.
+
+class FrequencySketch {
+public:
+    static constexpr unsigned MAX_FREQUENCY = 15;
+
+    // The width should be about the number of entries in the cache.
+    explicit FrequencySketch(std::size_t width) : m_width{round_up(width)} {
+        m_counters.resize(DEPTH * m_width);
+        m_sample_size = SAMPLE_SIZE_FACTOR * m_width;
+    }
+
+    void increment(std::size_t hash) {
+        for (std::size_t row = 0; row < DEPTH; ++row) {
+            auto& counter = m_counters[index(row, hash)];
+            if (counter < MAX_FREQUENCY) {
+                ++counter;
+            }
+        }
+        if (++m_additions >= m_sample_size) {
+            age();
+        }
+    }
+
+    unsigned estimate(std::size_t hash) const {
+        unsigned result = MAX_FREQUENCY;
+        for (std::size_t row = 0; row < DEPTH; ++row) {
+            result = std::min<unsigned>(result, m_counters[index(row, hash)]);
+        }
+        return result;
+    }
+
+private:
+    static constexpr std::size_t DEPTH = 4;
+    static constexpr std::size_t SAMPLE_SIZE_FACTOR = 10;
+
+    static constexpr std::array<std::uint64_t, DEPTH> SEEDS{
+        0x9e3779b97f4a7c15ull,
+        0xc2b2ae3d27d4eb4full,
+        0x165667b19e3779f9ull,
+        0x27d4eb2f165667c5ull,
+    };
+
+    static std::size_t round_up(std::size_t width) {
+        // Too few counters would make the estimates useless.
+        std::size_t result = 1024;
+        while (result < width) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    std::size_t index(std::size_t row, std::size_t hash) const {
+        auto x = (static_cast<std::uint64_t>(hash) + row) * SEEDS[row];
+        x ^= x >> 32;
+        return row * m_width + static_cast<std::size_t>(x & (m_width - 1));
+    }
+
+    void age() {
+        for (auto& counter : m_counters) {
+            counter /= 2;
+        }
+        m_additions /= 2;
+    }
+
+    const std::size_t m_width;
+    std::vector<std::uint8_t> m_counters;
+    std::size_t m_sample_size;
+    std::size_t m_additions = 0;
+};
+
+} // namespace math::server
@@ -0,0 +1,32 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <common/error.hpp>
+#include <common/result.hpp>
+#include <parser/error.hpp>
+
+#include <string>
+
+namespace math::server {
+
+class CommandError : public Error {
+public:
+    explicit CommandError(const std::string& what) : Error{"command error: " + what} {}
+    explicit CommandError(const ErrorInfo& info) : CommandError{info.get_message()} {}
+};
+
+namespace command {
+
+inline std::string to_string(const ErrorInfo& error) {
+    if (error.get_source() == ErrorInfo::Source::COMMAND) {
+        return CommandError{error}.what();
+    }
+    return parser::to_string(error);
+}
+
+} // namespace command
+} // namespace math::server
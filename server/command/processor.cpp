@@ -0,0 +1,227 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "processor.hpp"
+#include "registry.hpp"
+
+#include <common/result.hpp>
+#include <lexer/details/identifier.hpp>
+#include <lexer/details/parse.hpp>
+#include <parser/error.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace math::server {
+namespace {
+
+namespace identifier = lexer::details::identifier;
+
+constexpr std::string_view PREPARE{"prepare"};
+constexpr std::string_view EXECUTE{"execute"};
+constexpr std::string_view GLOBAL{"global"};
+
+ErrorInfo error(const char* msg, const std::string_view& context = {}) {
+    return {ErrorInfo::Source::COMMAND, msg, context};
+}
+
+constexpr bool is_whitespace(char c) {
+    // Same as the lexer.
+    return c == ' ' || ('\t' <= c && c <= '\r');
+}
+
+} // namespace
+
+// The commands are simple enough not to bother with a separate lexer.
+class CommandProcessor::Cursor {
+public:
+    explicit Cursor(const std::string_view& input) : m_input{input} {}
+
+    const std::string_view& rest() {
+        skip_whitespace();
+        return m_input;
+    }
+
+    bool empty() { return rest().empty(); }
+
+    bool peek(char c) { return !empty() && m_input.front() == c; }
+
+    bool skip(char c) {
+        if (!peek(c)) {
+            return false;
+        }
+        m_input.remove_prefix(1);
+        return true;
+    }
+
+    // Returns an empty string if there's no identifier.
+    std::string_view identifier() {
+        const auto length = identifier::scan(rest());
+        const auto result = m_input.substr(0, length);
+        m_input.remove_prefix(length);
+        return result;
+    }
+
+    // A number with an optional sign.
+    Result<std::optional<double>> number() {
+        bool negative = false;
+        if (skip('-')) {
+            negative = true;
+        } else {
+            skip('+');
+        }
+        std::string_view token;
+        const auto result = lexer::details::try_parse_number(rest(), token);
+        if (!result || !result->has_value()) {
+            return result;
+        }
+        m_input.remove_prefix(token.length());
+        return std::optional<double>{negative ? -**result : **result};
+    }
+
+private:
+    void skip_whitespace() {
+        while (!m_input.empty() && is_whitespace(m_input.front())) {
+            m_input.remove_prefix(1);
+        }
+    }
+
+    std::string_view m_input;
+};
+
+bool CommandProcessor::is_command(const std::string_view& input) {
+    const auto keyword = get_name(input);
+    return keyword == PREPARE || keyword == EXECUTE;
+}
+
+std::string_view CommandProcessor::get_name(const std::string_view& input) {
+    return Cursor{input}.identifier();
+}
+
+ErrorInfo CommandProcessor::reject_long_line(const std::string_view& input) {
+    if (is_command(input)) {
+        return error("command is too long");
+    }
+    return parser::unknown_variable(get_name(input));
+}
+
+Result<CommandProcessor::Reply> CommandProcessor::exec(const std::string_view& input) {
+    Cursor cursor{input};
+    const auto keyword = cursor.identifier();
+    if (keyword == PREPARE) {
+        return prepare(cursor);
+    }
+    if (keyword == EXECUTE) {
+        return execute(cursor);
+    }
+    return error("unknown command", input);
+}
+
+Result<CommandProcessor::Reply> CommandProcessor::prepare(Cursor& cursor) {
+    auto registry = &m_session;
+    auto name = cursor.identifier();
+    // "prepare global(x) = x" defines an expression called "global".
+    if (name == GLOBAL && !cursor.peek('(')) {
+        if (m_global == nullptr) {
+            return error("global expressions are disabled");
+        }
+        registry = m_global;
+        name = cursor.identifier();
+    }
+    if (name.empty()) {
+        return error("expected a name", cursor.rest());
+    }
+
+    if (!cursor.skip('(')) {
+        return error("expected '('", cursor.rest());
+    }
+    auto expr = std::make_shared<PreparedExpression>(m_jit_threshold);
+    auto& params = expr->m_params;
+    if (!cursor.skip(')')) {
+        do {
+            const auto param = cursor.identifier();
+            if (param.empty()) {
+                return error("expected a parameter name", cursor.rest());
+            }
+            if (std::find(params.cbegin(), params.cend(), param) != params.cend()) {
+                return error("duplicate parameter", param);
+            }
+            params.emplace_back(param);
+        } while (cursor.skip(','));
+        if (!cursor.skip(')')) {
+            return error("expected ',' or ')'", cursor.rest());
+        }
+    }
+    if (!cursor.skip('=')) {
+        return error("expected '='", cursor.rest());
+    }
+
+    auto& program = expr->m_program.get_program();
+    if (const auto status = m_compiler.compile(cursor.rest(), params, program); !status) {
+        return status.error();
+    }
+    if (!registry->define(name, std::move(expr))) {
+        return error("too many prepared expressions");
+    }
+    return Reply{};
+}
+
+Result<CommandProcessor::Reply> CommandProcessor::execute(Cursor& cursor) {
+    const auto name = cursor.identifier();
+    if (name.empty()) {
+        return error("expected a name", cursor.rest());
+    }
+    const auto expr = find(name);
+    if (!expr) {
+        return error("unknown expression", name);
+    }
+
+    if (!cursor.skip('(')) {
+        return error("expected '('", cursor.rest());
+    }
+    m_args.clear();
+    if (!cursor.skip(')')) {
+        do {
+            const auto arg = cursor.number();
+            if (!arg) {
+                return arg.error();
+            }
+            if (!arg->has_value()) {
+                return error("expected a number", cursor.rest());
+            }
+            m_args.emplace_back(**arg);
+        } while (cursor.skip(','));
+        if (!cursor.skip(')')) {
+            return error("expected ',' or ')'", cursor.rest());
+        }
+    }
+    if (!cursor.empty()) {
+        return error("unexpected input after ')'", cursor.rest());
+    }
+    if (m_args.size() != expr->m_params.size()) {
+        return error("wrong number of arguments", name);
+    }
+
+    const auto result = expr->m_program.exec(m_args, m_stack);
+    if (!result) {
+        return result.error();
+    }
+    return Reply{*result};
+}
+
+ExpressionRegistry::Ptr CommandProcessor::find(const std::string_view& name) const {
+    if (auto expr = m_session.find(name)) {
+        return expr;
+    }
+    if (m_global != nullptr) {
+        return m_global->find(name);
+    }
+    return nullptr;
+}
+
+} // namespace math::server
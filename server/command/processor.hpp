@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "registry.hpp"
+
+#include <common/result.hpp>
+#include <jit/hot_program.hpp>
+#include <parser/compiler.hpp>
+#include <parser/shunting_yard.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace math::server {
+
+// Protocol commands for prepared expressions:
+//
+//     prepare [global] NAME(PARAM, ...) = EXPRESSION
+//     execute NAME(NUMBER, ...)
+//
+// "prepare" compiles the expression and stores it either for the rest of the
+// session or (with "global") for every session.
+// "execute" evaluates it with the arguments bound to the parameters, without
+// lexing or parsing the expression again.
+// Session expressions shadow global ones with the same name.
+// Expressions executed at least jit_threshold times are compiled to native
+// code (see HotProgram).
+
+class CommandProcessor {
+public:
+    // The global registry is optional.
+    explicit CommandProcessor(ExpressionRegistry* global = nullptr,
+                              std::size_t max_depth = parser::DEFAULT_MAX_DEPTH,
+                              std::size_t jit_threshold = HotProgram::DEFAULT_THRESHOLD)
+        : m_global{global}, m_compiler{max_depth}, m_jit_threshold{jit_threshold} {}
+
+    CommandProcessor(const CommandProcessor&) = delete;
+    CommandProcessor& operator=(const CommandProcessor&) = delete;
+
+    // Commands start with a keyword, and an expression can't start with an
+    // identifier anyway.
+    static bool is_command(const std::string_view& input);
+
+    // The identifier the input starts with (if any), in which case it's
+    // either a command or not an expression at all.
+    static std::string_view get_name(const std::string_view& input);
+
+    // The reply to a line like that which is too long to be buffered, given
+    // its start: commands have to be buffered in full.
+    static ErrorInfo reject_long_line(const std::string_view& input);
+
+    // Nothing for "prepare", and the result for "execute".
+    using Reply = std::optional<double>;
+
+    // Invalid input is reported without throwing.
+    Result<Reply> exec(const std::string_view& input);
+
+    // Forgets the expressions prepared for the session.
+    void reset() { m_session.clear(); }
+
+private:
+    class Cursor;
+
+    Result<Reply> prepare(Cursor&);
+    Result<Reply> execute(Cursor&);
+
+    ExpressionRegistry::Ptr find(const std::string_view& name) const;
+
+    ExpressionRegistry m_session;
+    ExpressionRegistry* const m_global;
+
+    Compiler m_compiler;
+    const std::size_t m_jit_threshold;
+    // Reused between commands to avoid memory allocations.
+    std::vector<double> m_args;
+    std::vector<double> m_stack;
+};
+
+} // namespace math::server
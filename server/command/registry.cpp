@@ -0,0 +1,50 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "registry.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace math::server {
+
+bool ExpressionRegistry::define(const std::string_view& name, Ptr expr) {
+    std::lock_guard<std::shared_mutex> lck{m_mtx};
+    const auto it = m_entries.find(name);
+    if (it != m_entries.end()) {
+        it->second = std::move(expr);
+        return true;
+    }
+    if (m_entries.size() >= m_max_entries) {
+        return false;
+    }
+    m_entries.emplace(std::string{name}, std::move(expr));
+    return true;
+}
+
+ExpressionRegistry::Ptr ExpressionRegistry::find(const std::string_view& name) const {
+    std::shared_lock<std::shared_mutex> lck{m_mtx};
+    const auto it = m_entries.find(name);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+std::size_t ExpressionRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lck{m_mtx};
+    return m_entries.size();
+}
+
+void ExpressionRegistry::clear() {
+    std::lock_guard<std::shared_mutex> lck{m_mtx};
+    m_entries.clear();
+}
+
+} // namespace math::server
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <jit/hot_program.hpp>
+#include <parser/compiler.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+
+namespace math::server {
+
+// An expression with named parameters, compiled once and evaluated with
+// different arguments any number of times.
+struct PreparedExpression {
+    explicit PreparedExpression(std::size_t jit_threshold = HotProgram::DEFAULT_THRESHOLD)
+        : m_program{jit_threshold} {}
+
+    Compiler::Params m_params;
+    HotProgram m_program;
+};
+
+// Prepared expressions by name.
+// There's one per session, and one shared by the whole server, so it's
+// guarded by a lock.
+// Expressions are immutable once defined, and whoever evaluates one holds a
+// reference to it, so it can be redefined at any time.
+
+class ExpressionRegistry {
+public:
+    using Ptr = std::shared_ptr<const PreparedExpression>;
+
+    // Limits the memory a client can make the server allocate.
+    static constexpr std::size_t DEFAULT_MAX_ENTRIES = 1024;
+
+    explicit ExpressionRegistry(std::size_t max_entries = DEFAULT_MAX_ENTRIES)
+        : m_max_entries{max_entries} {}
+
+    ExpressionRegistry(const ExpressionRegistry&) = delete;
+    ExpressionRegistry& operator=(const ExpressionRegistry&) = delete;
+
+    // Replaces the expression with the same name, if any.
+    // Returns false if the registry is full.
+    bool define(const std::string_view& name, Ptr expr);
+
+    // Returns nullptr if there's no such expression.
+    Ptr find(const std::string_view& name) const;
+
+    std::size_t size() const;
+
+    void clear();
+
+private:
+    const std::size_t m_max_entries;
+
+    mutable std::shared_mutex m_mtx;
+    // std::less<> allows looking up by std::string_view.
+    std::map<std::string, Ptr, std::less<>> m_entries;
+};
+
+} // namespace math::server
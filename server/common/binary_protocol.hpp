@@ -0,0 +1,126 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace math::server::binary {
+
+// A client switches to the binary protocol by sending this as the very first
+// byte, which can't start a line of text.
+// Then every request is
+//
+//     u32 id | u32 length | expression (length bytes)
+//
+// and every response is
+//
+//     u32 id | u8 status | payload
+//
+// where the payload depends on the status: a double for RESULT, a u32 length
+// and the message for FAILURE, and nothing for OK (a successful "prepare").
+// A batch request (expressions separated by ';') gets a single BATCH
+// response, the payload of which is a u32 count followed by that many
+//
+//     u8 status | payload
+//
+// items, one per expression.
+// Integers are little-endian, and doubles are IEEE-754 binary64, also
+// little-endian.
+// Both the server and math-client use this.
+
+constexpr unsigned char MAGIC = 0xb1;
+
+constexpr std::size_t REQUEST_HEADER_SIZE = 8;
+
+enum class Status : std::uint8_t {
+    RESULT = 0,
+    FAILURE = 1,
+    OK = 2,
+    BATCH = 3,
+};
+
+struct RequestHeader {
+    std::uint32_t m_id;
+    std::uint32_t m_length;
+};
+
+inline std::uint32_t decode_u32(const char* src) {
+    const auto bytes = reinterpret_cast<const unsigned char*>(src);
+    return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 |
+           static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+
+inline std::uint64_t decode_u64(const char* src) {
+    return static_cast<std::uint64_t>(decode_u32(src)) |
+           static_cast<std::uint64_t>(decode_u32(src + 4)) << 32;
+}
+
+inline double decode_double(const char* src) {
+    const auto bits = decode_u64(src);
+    double result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// The buffer must hold at least REQUEST_HEADER_SIZE bytes.
+inline RequestHeader decode_header(const char* src) {
+    return {decode_u32(src), decode_u32(src + 4)};
+}
+
+template <typename T>
+void encode_le(std::string& dest, T value) {
+    char bytes[sizeof(value)];
+    for (std::size_t i = 0; i < sizeof(value); ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    dest.append(bytes, sizeof(bytes));
+}
+
+inline void encode_u32(std::string& dest, std::uint32_t value) {
+    encode_le(dest, value);
+}
+
+// Must be followed by the expression.
+inline void encode_header(std::string& dest, const RequestHeader& header) {
+    encode_u32(dest, header.m_id);
+    encode_u32(dest, header.m_length);
+}
+
+// Every response starts with the request's ID (see encode_u32), followed by
+// one of these.
+
+inline void encode_status(std::string& dest, Status status) {
+    dest += static_cast<char>(status);
+}
+
+inline void encode_result(std::string& dest, double result) {
+    encode_status(dest, Status::RESULT);
+    std::uint64_t bits;
+    std::memcpy(&bits, &result, sizeof(bits));
+    encode_le(dest, bits);
+}
+
+inline void encode_error(std::string& dest, const std::string_view& msg) {
+    encode_status(dest, Status::FAILURE);
+    encode_u32(dest, static_cast<std::uint32_t>(msg.length()));
+    dest += msg;
+}
+
+inline void encode_ok(std::string& dest) {
+    encode_status(dest, Status::OK);
+}
+
+// Must be followed by the items.
+inline void encode_batch(std::string& dest, std::uint32_t count) {
+    encode_status(dest, Status::BATCH);
+    encode_u32(dest, count);
+}
+
+} // namespace math::server::binary
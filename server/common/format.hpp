@@ -0,0 +1,47 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "error.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <system_error>
+
+namespace math::server::format {
+
+// Numbers are formatted using std::to_chars, which doesn't allocate and
+// doesn't depend on the current locale.
+// Precision of 0 means the shortest representation that still round-trips,
+// which is usually a lot shorter than the 17 significant digits required to
+// represent an arbitrary double.
+
+constexpr unsigned SHORTEST = 0;
+constexpr unsigned MAX_PRECISION = std::numeric_limits<double>::max_digits10;
+
+// Enough for any double, e.g. -1.2345678901234567e-308.
+constexpr std::size_t MAX_NUMBER_LENGTH = 32;
+
+// Returns the end of the formatted number.
+inline char* number(char* first, char* last, double value, unsigned precision = SHORTEST) {
+    const auto result = precision == SHORTEST
+                            ? std::to_chars(first, last, value)
+                            : std::to_chars(first, last, value, std::chars_format::general,
+                                            static_cast<int>(precision));
+    if (result.ec != std::errc{}) {
+        throw Error{"internal: couldn't format number"};
+    }
+    return result.ptr;
+}
+
+inline std::string number(double value, unsigned precision = SHORTEST) {
+    char buffer[MAX_NUMBER_LENGTH];
+    return {buffer, number(buffer, buffer + MAX_NUMBER_LENGTH, value, precision)};
+}
+
+} // namespace math::server::format
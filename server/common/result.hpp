@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace math::server {
+
+// Invalid input is common enough for exceptions to be too expensive a way to
+// report it.
+// This describes an error without throwing anything or allocating memory: the
+// message is a string literal, and the context is a view into the input.
+
+class ErrorInfo {
+public:
+    enum class Source {
+        LEXER,
+        PARSER,
+        COMMAND,
+    };
+
+    // Replies must not grow with the input.
+    static constexpr std::size_t MAX_CONTEXT_LENGTH = 64;
+
+    ErrorInfo(Source source, const char* msg, const std::string_view& context = {})
+        : m_source{source}, m_msg{msg}, m_context{context} {}
+
+    Source get_source() const { return m_source; }
+
+    const char* get_msg() const { return m_msg; }
+
+    const std::string_view& get_context() const { return m_context; }
+
+    // The message with the (truncated) context appended.
+    std::string get_message() const {
+        std::string result{m_msg};
+        if (m_context.empty()) {
+            return result;
+        }
+        result += ": ";
+        if (m_context.length() > MAX_CONTEXT_LENGTH) {
+            result += m_context.substr(0, MAX_CONTEXT_LENGTH);
+            result += "...";
+        } else {
+            result += m_context;
+        }
+        return result;
+    }
+
+private:
+    Source m_source;
+    const char* m_msg;
+    std::string_view m_context;
+};
+
+// Either a value or an error, like std::expected.
+template <typename T>
+class Result {
+public:
+    Result(const T& value) : m_value{std::in_place_index<0>, value} {}
+    Result(T&& value) : m_value{std::in_place_index<0>, std::move(value)} {}
+    Result(const ErrorInfo& error) : m_value{std::in_place_index<1>, error} {}
+
+    bool has_value() const { return m_value.index() == 0; }
+
+    explicit operator bool() const { return has_value(); }
+
+    const T& value() const { return *std::get_if<0>(&m_value); }
+    T& value() { return *std::get_if<0>(&m_value); }
+
+    const T& operator*() const { return value(); }
+    T& operator*() { return value(); }
+
+    const T* operator->() const { return &value(); }
+    T* operator->() { return &value(); }
+
+    const ErrorInfo& error() const { return *std::get_if<1>(&m_value); }
+
+private:
+    std::variant<T, ErrorInfo> m_value;
+};
+
+// For operations that either succeed or fail, but produce no value.
+using Status = Result<std::monostate>;
+
+inline Status success() {
+    return std::monostate{};
+}
+
+} // namespace math::server
@@ -0,0 +1,125 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "parallel_parser.hpp"
+
+#include "worker_pool.hpp"
+
+#include <common/result.hpp>
+#include <lexer/lexer.hpp>
+#include <parser/evaluator.hpp>
+#include <parser/segments.hpp>
+#include <parser/shunting_yard.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <string_view>
+
+namespace math::server {
+namespace {
+
+// Integers up to this are exact, and so are their sums if those are too.
+constexpr double MAX_EXACT_INTEGER = 9007199254740992.; // 2^53
+
+} // namespace
+
+ParallelParser::ParallelParser(WorkerPool* pool, std::size_t threshold, std::size_t max_depth)
+    : m_pool{pool}, m_threshold{threshold}, m_max_depth{max_depth} {}
+
+Result<double> ParallelParser::try_exec(const std::string_view& input) {
+    m_parallel = false;
+    if (const auto status = Lexer::try_tokenize_all(input, m_tokens); !status) {
+        return status.error();
+    }
+    if (!is_parallel() || is_likely_inexact()) {
+        return exec_serial();
+    }
+    parser::split(m_tokens, MIN_SEGMENT_TOKENS, m_segments);
+    if (m_segments.size() < 2) {
+        return exec_serial();
+    }
+    return exec_parallel();
+}
+
+bool ParallelParser::is_parallel() const {
+    return m_pool != nullptr && m_threshold != 0 && m_tokens.size() >= m_threshold;
+}
+
+bool ParallelParser::is_likely_inexact() const {
+    // Not worth splitting the input if the terms are unlikely to be integers.
+    for (std::size_t i = 0; i < m_tokens.size(); ++i) {
+        if (m_tokens.get_type(i) == lexer::Token::Type::SLASH) {
+            return true;
+        }
+    }
+    for (std::size_t i = 0; i < m_tokens.numof_numbers(); ++i) {
+        const auto number = m_tokens.get_number(i);
+        if (std::trunc(number) != number) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Result<double> ParallelParser::exec_serial() {
+    m_parallel = false;
+    return parser::evaluate(m_tokens, m_tokens.all(), m_max_depth);
+}
+
+Result<double> ParallelParser::exec_parallel() {
+    const auto n = m_segments.size();
+    m_sums.assign(n, {});
+
+    m_pool->parallel_for(n, [this](std::size_t i) { m_sums[i] = sum_terms(m_segments[i]); });
+
+    double magnitude = 0;
+    for (const auto& sum : m_sums) {
+        if (sum.failed || !sum.integral) {
+            // The error must be the same as Parser's, which might not be the
+            // error of the first failed segment, and so must the result.
+            // Either is rare, so the input is simply evaluated again.
+            return exec_serial();
+        }
+        magnitude += sum.magnitude;
+    }
+    if (!(magnitude < MAX_EXACT_INTEGER)) {
+        return exec_serial();
+    }
+
+    // Every partial sum is exact, so the order doesn't matter.
+    double result = 0;
+    for (const auto& sum : m_sums) {
+        result += sum.value;
+    }
+    m_parallel = true;
+    return result;
+}
+
+ParallelParser::Sum ParallelParser::sum_terms(const lexer::TokenBuffer::Range& segment) const {
+    Sum sum;
+    parser::Evaluator evaluator;
+    parser::ShuntingYard<parser::Evaluator> yard{evaluator, m_max_depth};
+
+    parser::for_each_term(m_tokens, segment, [&](const lexer::TokenBuffer::Range& term) {
+        if (sum.failed || !sum.integral) {
+            return;
+        }
+        evaluator.reset();
+        yard.reset();
+        yard.on_tokens(m_tokens, term);
+        if (!yard.finish()) {
+            sum.failed = true;
+            return;
+        }
+        const auto value = evaluator.get_result();
+        // False for NaN; infinities are too large anyway.
+        sum.integral = std::trunc(value) == value;
+        sum.value += value;
+        sum.magnitude += std::abs(value);
+    });
+    return sum;
+}
+
+} // namespace math::server
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "worker_pool.hpp"
+
+#include <common/result.hpp>
+#include <lexer/token_buffer.hpp>
+#include <parser/shunting_yard.hpp>
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace math::server {
+
+// Evaluates long expressions on a worker pool.
+// The input is split into sums of independent segments (see parser::split),
+// which are evaluated in parallel and then added up.
+// Adding the terms up in a different order than Parser does could change the
+// result, so this is only done if every term is an integer and the sum of
+// their magnitudes is below 2^53, in which case every partial sum is exact.
+// Otherwise (e.g. if a number has a fractional part), the input is evaluated
+// serially, so the result is always the same as Parser's.
+// Inputs with fractions or divisions aren't even split.
+// Expressions shorter than the threshold (in tokens) are evaluated serially.
+
+class ParallelParser {
+public:
+    static constexpr std::size_t DEFAULT_THRESHOLD = 4096;
+    static constexpr std::size_t MIN_SEGMENT_TOKENS = 1024;
+
+    // Every expression is evaluated serially without a pool, or if the
+    // threshold is 0.
+    explicit ParallelParser(WorkerPool* pool = nullptr,
+                            std::size_t threshold = DEFAULT_THRESHOLD,
+                            std::size_t max_depth = parser::DEFAULT_MAX_DEPTH);
+
+    ParallelParser(const ParallelParser&) = delete;
+    ParallelParser& operator=(const ParallelParser&) = delete;
+
+    // Errors are the same as Parser's.
+    Result<double> try_exec(const std::string_view& input);
+
+    // Whether the last input was evaluated in parallel.
+    bool was_parallel() const { return m_parallel; }
+
+private:
+    // The terms of a segment, added up in order.
+    struct Sum {
+        double value = 0;
+        double magnitude = 0;
+        bool integral = true;
+        bool failed = false;
+    };
+
+    bool is_parallel() const;
+    bool is_likely_inexact() const;
+
+    Result<double> exec_serial();
+    Result<double> exec_parallel();
+
+    Sum sum_terms(const lexer::TokenBuffer::Range& segment) const;
+
+    WorkerPool* const m_pool;
+    const std::size_t m_threshold;
+    const std::size_t m_max_depth;
+
+    // Reused between inputs.
+    lexer::TokenBuffer m_tokens;
+    std::vector<lexer::TokenBuffer::Range> m_segments;
+    std::vector<Sum> m_sums;
+    bool m_parallel = false;
+};
+
+} // namespace math::server
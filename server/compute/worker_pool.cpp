@@ -0,0 +1,170 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "worker_pool.hpp"
+
+#include <common/error.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace math::server {
+namespace {
+
+// The pool and the index of the worker running on this thread, if any.
+thread_local const void* current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+} // namespace
+
+WorkerPool::WorkerPool(std::size_t numof_threads) {
+    m_workers.reserve(numof_threads);
+    for (std::size_t i = 0; i < numof_threads; ++i) {
+        m_workers.emplace_back(std::make_unique<Worker>());
+    }
+    // Workers might steal from each other as soon as they start.
+    for (std::size_t i = 0; i < numof_threads; ++i) {
+        m_workers[i]->m_thread = std::thread{[this, i]() { run(i); }};
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lck{m_mtx};
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker->m_thread.join();
+    }
+}
+
+void WorkerPool::post(Work work) {
+    if (m_workers.empty()) {
+        throw Error{"there are no workers"};
+    }
+    push(std::move(work));
+}
+
+void WorkerPool::parallel_for(std::size_t n, const Task& task) {
+    if (n == 0) {
+        return;
+    }
+
+    const auto job = std::make_shared<Job>(n, task);
+    // The calling thread takes one of the indices.
+    const auto helpers = std::min(m_workers.size(), n - 1);
+    for (std::size_t i = 0; i < helpers; ++i) {
+        // Might have been finished by others already, then it's a no-op.
+        push([job]() { job->work(); });
+    }
+
+    job->work();
+    job->wait();
+}
+
+void WorkerPool::push(Work work) {
+    const auto i = current_pool == this ? current_worker : m_next_worker++ % m_workers.size();
+    {
+        auto& worker = *m_workers[i];
+        std::lock_guard<std::mutex> lck{worker.m_mtx};
+        worker.m_queue.emplace_back(std::move(work));
+        ++m_queued;
+    }
+    {
+        // So that a worker that's about to wait doesn't miss it.
+        std::lock_guard<std::mutex> lck{m_mtx};
+    }
+    m_cv.notify_one();
+}
+
+bool WorkerPool::pop(std::size_t i, Work& work) {
+    auto& worker = *m_workers[i];
+    std::lock_guard<std::mutex> lck{worker.m_mtx};
+    if (worker.m_queue.empty()) {
+        return false;
+    }
+    work = std::move(worker.m_queue.back());
+    worker.m_queue.pop_back();
+    --m_queued;
+    return true;
+}
+
+bool WorkerPool::steal(std::size_t thief, Work& work) {
+    for (std::size_t n = 1; n < m_workers.size(); ++n) {
+        auto& victim = *m_workers[(thief + n) % m_workers.size()];
+        std::lock_guard<std::mutex> lck{victim.m_mtx};
+        if (victim.m_queue.empty()) {
+            continue;
+        }
+        work = std::move(victim.m_queue.front());
+        victim.m_queue.pop_front();
+        --m_queued;
+        return true;
+    }
+    return false;
+}
+
+void WorkerPool::run(std::size_t i) {
+    current_pool = this;
+    current_worker = i;
+
+    while (true) {
+        Work work;
+        if (pop(i, work) || steal(i, work)) {
+            work();
+            continue;
+        }
+        std::unique_lock<std::mutex> lck{m_mtx};
+        m_cv.wait(lck, [this]() { return m_stopping || m_queued > 0; });
+        if (m_stopping) {
+            return;
+        }
+    }
+}
+
+void WorkerPool::Job::work() {
+    std::size_t done = 0;
+    std::exception_ptr error;
+
+    for (auto i = m_next++; i < m_size; i = m_next++) {
+        try {
+            m_task(i);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        ++done;
+    }
+
+    if (done == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lck{m_mtx};
+    if (error && !m_error) {
+        m_error = error;
+    }
+    m_done += done;
+    if (m_done == m_size) {
+        m_cv.notify_all();
+    }
+}
+
+void WorkerPool::Job::wait() {
+    std::unique_lock<std::mutex> lck{m_mtx};
+    m_cv.wait(lck, [this]() { return m_done == m_size; });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+} // namespace math::server
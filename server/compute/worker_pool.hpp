@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace math::server {
+
+// Threads for CPU-bound work, separate from the IO threads.
+// Every worker has its own queue: it takes the work it queued itself last in,
+// first out, and steals from the others first in, first out when it runs out.
+// The thread that calls parallel_for does its share too, so that it makes
+// progress even if every worker is busy with someone else's.
+
+class WorkerPool {
+public:
+    using Work = std::function<void()>;
+    using Task = std::function<void(std::size_t)>;
+
+    explicit WorkerPool(std::size_t numof_threads);
+    // The work that hasn't been started yet is dropped.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    std::size_t get_numof_threads() const { return m_workers.size(); }
+
+    // Runs the work on one of the workers, and returns immediately.
+    // The work must not throw.
+    // There must be at least one worker.
+    void post(Work work);
+
+    // Calls task(i) for every i in [0, n), in no particular order, and waits
+    // for all of the calls to finish.
+    // If any of them throws, one of the exceptions is rethrown.
+    // Can be called by the workers themselves.
+    void parallel_for(std::size_t n, const Task& task);
+
+private:
+    class Job {
+    public:
+        Job(std::size_t n, const Task& task) : m_size{n}, m_task{task} {}
+
+        // Returns when there's nothing left to claim.
+        void work();
+        void wait();
+
+    private:
+        const std::size_t m_size;
+        // Only called for claimed indices, all of which are done before
+        // parallel_for returns.
+        const Task& m_task;
+
+        std::atomic<std::size_t> m_next{0};
+
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::size_t m_done = 0;
+        std::exception_ptr m_error;
+    };
+
+    struct Worker {
+        std::mutex m_mtx;
+        std::deque<Work> m_queue;
+        std::thread m_thread;
+    };
+
+    // Into the current worker's queue, or one of the queues in turn if it's
+    // not called by a worker.
+    void push(Work work);
+    // The newest work from the worker's own queue, or the oldest one from
+    // someone else's.
+    bool pop(std::size_t worker, Work& work);
+    bool steal(std::size_t thief, Work& work);
+    void run(std::size_t worker);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<std::size_t> m_next_worker{0};
+
+    // Idle workers wait for something to be queued.
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::atomic<std::size_t> m_queued{0};
+    bool m_stopping = false;
+};
+
+} // namespace math::server
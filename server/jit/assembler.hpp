@@ -0,0 +1,205 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace math::server::jit {
+
+// Encodes the handful of x86-64 instructions NativeProgram needs.
+// Reference: Intel 64 and IA-32 Architectures Software Developer's Manual,
+// Volume 2.
+
+enum class Reg : std::uint8_t {
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+};
+
+// XMM0 through XMM15.
+using Xmm = std::uint8_t;
+
+enum class Cond : std::uint8_t {
+    EQUAL = 0x4,
+    PARITY = 0xa,
+};
+
+class Assembler {
+public:
+    using Code = std::vector<std::uint8_t>;
+
+    // A jump with the destination yet unknown.
+    using Fixup = std::size_t;
+
+    const Code& get_code() const { return m_code; }
+
+    void push(Reg r) {
+        rex(false, 0, r);
+        emit(0x50 + low_bits(r));
+    }
+
+    void pop(Reg r) {
+        rex(false, 0, r);
+        emit(0x58 + low_bits(r));
+    }
+
+    // mov dst, src
+    void mov(Reg dst, Reg src) {
+        rex(true, index(src), dst);
+        emit(0x89);
+        modrm_reg(index(src), index(dst));
+    }
+
+    // mov dst, imm64
+    void mov(Reg dst, std::uint64_t imm) {
+        rex(true, 0, dst);
+        emit(0xb8 + low_bits(dst));
+        emit_bytes(imm);
+    }
+
+    // mov eax, imm32 (zeroes the upper half of RAX)
+    void mov_eax(std::uint32_t imm) {
+        emit(0xb8);
+        emit_bytes(imm);
+    }
+
+    void add_rsp(std::uint32_t imm) {
+        emit(0x48, 0x81, 0xc4);
+        emit_bytes(imm);
+    }
+
+    void sub_rsp(std::uint32_t imm) {
+        emit(0x48, 0x81, 0xec);
+        emit_bytes(imm);
+    }
+
+    void call(Reg r) {
+        rex(false, 0, r);
+        emit(0xff);
+        modrm_reg(2, index(r));
+    }
+
+    void ret() { emit(0xc3); }
+
+    Fixup jmp() {
+        emit(0xe9);
+        return emit_rel32();
+    }
+
+    Fixup jcc(Cond cond) {
+        emit(0x0f, 0x80 + static_cast<std::uint8_t>(cond));
+        return emit_rel32();
+    }
+
+    // Points the jump at the next instruction.
+    void bind(Fixup fixup) {
+        const auto rel = static_cast<std::int32_t>(m_code.size() - (fixup + 4));
+        std::memcpy(&m_code[fixup], &rel, sizeof(rel));
+    }
+
+    // movsd dst, [base + disp]
+    void movsd(Xmm dst, Reg base, std::int32_t disp) { sse_mem(0xf2, 0x10, dst, base, disp); }
+    // movsd [base + disp], src
+    void movsd(Reg base, std::int32_t disp, Xmm src) { sse_mem(0xf2, 0x11, src, base, disp); }
+
+    void movapd(Xmm dst, Xmm src) { sse(0x66, 0x28, dst, src); }
+    void addsd(Xmm dst, Xmm src) { sse(0xf2, 0x58, dst, src); }
+    void mulsd(Xmm dst, Xmm src) { sse(0xf2, 0x59, dst, src); }
+    void subsd(Xmm dst, Xmm src) { sse(0xf2, 0x5c, dst, src); }
+    void divsd(Xmm dst, Xmm src) { sse(0xf2, 0x5e, dst, src); }
+    void xorpd(Xmm dst, Xmm src) { sse(0x66, 0x57, dst, src); }
+    void ucomisd(Xmm a, Xmm b) { sse(0x66, 0x2e, a, b); }
+
+    // movq dst, src
+    void movq(Xmm dst, Reg src) {
+        emit(0x66);
+        rex(true, dst, src);
+        emit(0x0f, 0x6e);
+        modrm_reg(dst, index(src));
+    }
+
+private:
+    static std::uint8_t index(Reg r) { return static_cast<std::uint8_t>(r); }
+    static std::uint8_t low_bits(Reg r) { return index(r) & 7; }
+
+    template <typename... Bytes>
+    void emit(Bytes... bytes) {
+        (m_code.push_back(static_cast<std::uint8_t>(bytes)), ...);
+    }
+
+    template <typename T>
+    void emit_bytes(T value) {
+        // x86 is little-endian, and so is the host.
+        const auto pos = m_code.size();
+        m_code.resize(pos + sizeof(value));
+        std::memcpy(&m_code[pos], &value, sizeof(value));
+    }
+
+    Fixup emit_rel32() {
+        const auto pos = m_code.size();
+        emit_bytes(std::int32_t{0});
+        return pos;
+    }
+
+    // Only emitted when required.
+    void rex(bool w, std::uint8_t reg, Reg rm) {
+        const std::uint8_t prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | (index(rm) >> 3);
+        if (prefix != 0x40) {
+            emit(prefix);
+        }
+    }
+
+    void rex(bool w, std::uint8_t reg, std::uint8_t rm) { rex(w, reg, static_cast<Reg>(rm)); }
+
+    void modrm_reg(std::uint8_t reg, std::uint8_t rm) {
+        emit(0xc0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    // [base + disp32]
+    void modrm_mem(std::uint8_t reg, Reg base, std::int32_t disp) {
+        emit(0x80 | ((reg & 7) << 3) | low_bits(base));
+        if (low_bits(base) == low_bits(Reg::RSP)) {
+            // RSP and R12 can only be addressed with a SIB byte.
+            emit(0x24);
+        }
+        emit_bytes(disp);
+    }
+
+    // The mandatory prefix goes before REX.
+    void sse(std::uint8_t prefix, std::uint8_t opcode, Xmm reg, Xmm rm) {
+        emit(prefix);
+        rex(false, reg, rm);
+        emit(0x0f, opcode);
+        modrm_reg(reg, rm);
+    }
+
+    void sse_mem(std::uint8_t prefix, std::uint8_t opcode, Xmm reg, Reg base, std::int32_t disp) {
+        emit(prefix);
+        rex(false, reg, base);
+        emit(0x0f, opcode);
+        modrm_mem(reg, base, disp);
+    }
+
+    Code m_code;
+};
+
+} // namespace math::server::jit
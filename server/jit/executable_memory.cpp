@@ -0,0 +1,49 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "executable_memory.hpp"
+
+#include <common/error.hpp>
+
+#ifdef MATH_SERVER_JIT
+#include <sys/mman.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace math::server::jit {
+
+#ifdef MATH_SERVER_JIT
+
+ExecutableMemory::ExecutableMemory(const std::vector<std::uint8_t>& code) : m_size{code.size()} {
+    m_ptr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m_ptr == MAP_FAILED) {
+        throw Error{"couldn't map memory for native code"};
+    }
+    std::memcpy(m_ptr, code.data(), m_size);
+    // Never writable and executable at the same time.
+    if (::mprotect(m_ptr, m_size, PROT_READ | PROT_EXEC) != 0) {
+        ::munmap(m_ptr, m_size);
+        throw Error{"couldn't make native code executable"};
+    }
+}
+
+ExecutableMemory::~ExecutableMemory() {
+    ::munmap(m_ptr, m_size);
+}
+
+#else
+
+ExecutableMemory::ExecutableMemory(const std::vector<std::uint8_t>&) {
+    throw Error{"native code is not supported on this platform"};
+}
+
+ExecutableMemory::~ExecutableMemory() = default;
+
+#endif
+
+} // namespace math::server::jit
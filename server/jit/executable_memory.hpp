@@ -0,0 +1,32 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math::server::jit {
+
+// Machine code mapped into memory that's executable, but not writable.
+
+class ExecutableMemory {
+public:
+    // Throws if the memory couldn't be mapped.
+    explicit ExecutableMemory(const std::vector<std::uint8_t>& code);
+    ~ExecutableMemory();
+
+    ExecutableMemory(const ExecutableMemory&) = delete;
+    ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+
+    const void* get() const { return m_ptr; }
+
+private:
+    void* m_ptr = nullptr;
+    std::size_t m_size = 0;
+};
+
+} // namespace math::server::jit
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "hot_program.hpp"
+
+#include "native_program.hpp"
+
+#include <common/log.hpp>
+#include <common/result.hpp>
+
+#include <atomic>
+#include <exception>
+#include <vector>
+
+namespace math::server {
+
+Result<double> HotProgram::exec(const std::vector<double>& args,
+                                std::vector<double>& stack) const {
+    if (const auto native = m_native.load(std::memory_order_acquire)) {
+        return native->exec(args);
+    }
+    // Stop counting at the threshold, so that the counter never wraps around.
+    if (m_threshold != 0 && m_calls.load(std::memory_order_relaxed) < m_threshold) {
+        if (m_calls.fetch_add(1, std::memory_order_relaxed) + 1 == m_threshold) {
+            compile();
+            if (is_native()) {
+                return m_compiled->exec(args);
+            }
+        }
+    }
+    return m_program.exec(args, stack);
+}
+
+void HotProgram::compile() const {
+    try {
+        m_compiled = NativeProgram::compile(m_program);
+    } catch (const std::exception& e) {
+        log::error("%1%: %2%", __func__, e.what());
+        return;
+    }
+    m_native.store(m_compiled.get(), std::memory_order_release);
+}
+
+} // namespace math::server
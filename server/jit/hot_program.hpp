@@ -0,0 +1,58 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "native_program.hpp"
+
+#include <common/result.hpp>
+#include <parser/program.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace math::server {
+
+// A Program that's interpreted at first, and compiled to native code (see
+// NativeProgram) once it's been executed often enough.
+// If it can't be compiled, it's interpreted forever.
+// Can be executed by multiple threads at once.
+
+class HotProgram {
+public:
+    static constexpr std::size_t DEFAULT_THRESHOLD = 1000;
+
+    // The program is never compiled if the threshold is 0.
+    explicit HotProgram(std::size_t threshold = DEFAULT_THRESHOLD) : m_threshold{threshold} {}
+
+    HotProgram(const HotProgram&) = delete;
+    HotProgram& operator=(const HotProgram&) = delete;
+
+    // Must not be modified after the first call to exec().
+    Program& get_program() { return m_program; }
+    const Program& get_program() const { return m_program; }
+
+    bool is_native() const { return m_native.load(std::memory_order_acquire) != nullptr; }
+
+    // The stack is only used by the interpreter.
+    Result<double> exec(const std::vector<double>& args, std::vector<double>& stack) const;
+
+private:
+    void compile() const;
+
+    Program m_program;
+
+    const std::size_t m_threshold;
+    mutable std::atomic<std::size_t> m_calls{0};
+
+    // Only the thread that bumps the counter up to the threshold compiles the
+    // program, and the others keep interpreting it until it's published.
+    mutable std::unique_ptr<NativeProgram> m_compiled;
+    mutable std::atomic<const NativeProgram*> m_native{nullptr};
+};
+
+} // namespace math::server
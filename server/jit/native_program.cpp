@@ -0,0 +1,210 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "native_program.hpp"
+
+#include "assembler.hpp"
+#include "executable_memory.hpp"
+
+#include <common/result.hpp>
+#include <parser/program.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace math::server {
+namespace {
+
+using jit::Assembler;
+using jit::Cond;
+using jit::Reg;
+using jit::Xmm;
+using Opcode = Program::Opcode;
+
+// Callee-saved, so that they survive calls to std::pow.
+constexpr Reg CONSTANTS = Reg::RBX;
+constexpr Reg ARGS = Reg::RBP;
+constexpr Reg RESULT = Reg::R14;
+
+// XMM0 and XMM1 pass the arguments to std::pow, and XMM15 is scratch.
+constexpr Xmm FIRST_SLOT = 2;
+constexpr Xmm SCRATCH = 15;
+
+// The stack slots are spilled here around calls.
+// Three registers are pushed on entry, so this keeps RSP 16-byte aligned.
+constexpr std::uint32_t FRAME_SIZE = 8 * 14;
+
+constexpr std::uint64_t SIGN_BIT = 0x8000000000000000ull;
+
+using Pow = double (*)(double, double);
+
+ErrorInfo error(const char* msg) {
+    return {ErrorInfo::Source::PARSER, msg};
+}
+
+Xmm slot(std::size_t i) {
+    return static_cast<Xmm>(FIRST_SLOT + i);
+}
+
+std::int32_t offset(std::size_t i) {
+    return static_cast<std::int32_t>(8 * i);
+}
+
+// Returns nothing if the program is malformed or too deep.
+std::optional<Assembler::Code> translate(const Program& program) {
+    if (program.empty() || program.get_max_depth() > NativeProgram::MAX_DEPTH) {
+        return {};
+    }
+
+    Assembler a;
+    a.push(CONSTANTS);
+    a.push(ARGS);
+    a.push(RESULT);
+    a.sub_rsp(FRAME_SIZE);
+    // The System V calling convention.
+    a.mov(CONSTANTS, Reg::RDI);
+    a.mov(ARGS, Reg::RSI);
+    a.mov(RESULT, Reg::RDX);
+
+    std::vector<Assembler::Fixup> division_by_zero;
+    std::size_t top = 0;
+    std::size_t constant = 0;
+    std::size_t variable = 0;
+
+    for (const auto op : program.get_code()) {
+        if (op == Opcode::PUSH || op == Opcode::LOAD) {
+            if (op == Opcode::PUSH) {
+                a.movsd(slot(top), CONSTANTS, offset(constant++));
+            } else {
+                a.movsd(slot(top), ARGS, offset(program.get_variables()[variable++]));
+            }
+            ++top;
+            continue;
+        }
+        if (top < (Program::is_binary(op) ? 2 : 1)) {
+            return {};
+        }
+
+        const auto lhs = slot(top - 2);
+        const auto rhs = slot(top - 1);
+        switch (op) {
+            case Opcode::ADD:
+                a.addsd(lhs, rhs);
+                break;
+
+            case Opcode::SUB:
+                a.subsd(lhs, rhs);
+                break;
+
+            case Opcode::MUL:
+                a.mulsd(lhs, rhs);
+                break;
+
+            case Opcode::DIV: {
+                // NaN compares unordered, and isn't zero.
+                a.xorpd(SCRATCH, SCRATCH);
+                a.ucomisd(rhs, SCRATCH);
+                const auto unordered = a.jcc(Cond::PARITY);
+                division_by_zero.emplace_back(a.jcc(Cond::EQUAL));
+                a.bind(unordered);
+                a.divsd(lhs, rhs);
+                break;
+            }
+
+            case Opcode::POW:
+                // Every XMM register is caller-saved.
+                for (std::size_t i = 0; i + 2 < top; ++i) {
+                    a.movsd(Reg::RSP, offset(i), slot(i));
+                }
+                a.movapd(0, lhs);
+                a.movapd(1, rhs);
+                a.mov(Reg::RAX, reinterpret_cast<std::uint64_t>(static_cast<Pow>(&std::pow)));
+                a.call(Reg::RAX);
+                a.movapd(lhs, 0);
+                for (std::size_t i = 0; i + 2 < top; ++i) {
+                    a.movsd(slot(i), Reg::RSP, offset(i));
+                }
+                break;
+
+            case Opcode::NEG:
+                a.mov(Reg::RAX, SIGN_BIT);
+                a.movq(SCRATCH, Reg::RAX);
+                a.xorpd(rhs, SCRATCH);
+                break;
+
+            default:
+                return {};
+        }
+        if (Program::is_binary(op)) {
+            --top;
+        }
+    }
+    if (top != 1) {
+        return {};
+    }
+
+    a.movsd(RESULT, 0, slot(0));
+    a.mov_eax(0);
+    const auto epilogue = a.jmp();
+
+    for (const auto fixup : division_by_zero) {
+        a.bind(fixup);
+    }
+    a.mov_eax(1);
+
+    a.bind(epilogue);
+    a.add_rsp(FRAME_SIZE);
+    a.pop(RESULT);
+    a.pop(ARGS);
+    a.pop(CONSTANTS);
+    a.ret();
+
+    return a.get_code();
+}
+
+} // namespace
+
+bool NativeProgram::is_supported() {
+#ifdef MATH_SERVER_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<NativeProgram> NativeProgram::compile(const Program& program) {
+    if (!is_supported()) {
+        return nullptr;
+    }
+    const auto code = translate(program);
+    if (!code) {
+        return nullptr;
+    }
+    return std::unique_ptr<NativeProgram>{new NativeProgram{program, *code}};
+}
+
+NativeProgram::NativeProgram(const Program& program, const std::vector<std::uint8_t>& code)
+    : m_constants{program.get_constants()},
+      m_numof_args{program.get_numof_args()},
+      m_code_size{code.size()},
+      m_memory{code},
+      m_function{reinterpret_cast<Function>(const_cast<void*>(m_memory.get()))} {}
+
+Result<double> NativeProgram::exec(const std::vector<double>& args) const {
+    if (args.size() < m_numof_args) {
+        return error("internal: not enough arguments");
+    }
+    double result = 0;
+    if (m_function(m_constants.data(), args.data(), &result) != 0) {
+        return error("division by zero");
+    }
+    return result;
+}
+
+} // namespace math::server
@@ -0,0 +1,56 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "executable_memory.hpp"
+
+#include <common/result.hpp>
+#include <parser/program.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace math::server {
+
+// A Program translated into x86-64 machine code.
+// There's no dispatch at all: the opcodes become straight-line SSE2 scalar
+// instructions, and the stack slots become XMM registers.
+// ^ calls std::pow, and the division by zero check is a branch, so the
+// results (and the errors) are exactly the same as Program::exec's.
+
+class NativeProgram {
+public:
+    // One stack slot for each of XMM2 through XMM14.
+    static constexpr std::size_t MAX_DEPTH = 13;
+
+    // False if the server was built without the JIT, or for a different
+    // platform than x86-64 Linux.
+    static bool is_supported();
+
+    // Returns nullptr if the program can't be compiled: it's too deep, or the
+    // JIT isn't supported.
+    // Throws if the code can't be mapped into memory.
+    static std::unique_ptr<NativeProgram> compile(const Program&);
+
+    Result<double> exec(const std::vector<double>& args) const;
+
+    std::size_t get_code_size() const { return m_code_size; }
+
+private:
+    // Returns non-zero on division by zero.
+    using Function = int (*)(const double* constants, const double* args, double* result);
+
+    NativeProgram(const Program&, const std::vector<std::uint8_t>& code);
+
+    const std::vector<double> m_constants;
+    const std::size_t m_numof_args;
+    const std::size_t m_code_size;
+    const jit::ExecutableMemory m_memory;
+    const Function m_function;
+};
+
+} // namespace math::server
@@ -0,0 +1,393 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "classify.hpp"
+#include "identifier.hpp"
+#include "number.hpp"
+
+#include <lexer/error.hpp>
+#include <lexer/token_type.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SERVER_HAS_SSE2
+#endif
+
+#ifdef MATH_SERVER_HAS_SSE2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(MATH_SERVER_HAS_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define MATH_SERVER_HAS_AVX2
+#ifdef __GNUC__
+#define MATH_SERVER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MATH_SERVER_TARGET_AVX2
+#endif
+#endif
+
+namespace math::server::lexer::details {
+namespace {
+
+using Word = CharMap::Word;
+using Class = CharMap::Class;
+using Impl = CharMap::Impl;
+
+constexpr std::size_t WORD_BITS = CharMap::WORD_BITS;
+constexpr std::size_t NUMOF_CLASSES = 4;
+
+// Single-character tokens, in no particular order.
+class Operators {
+public:
+    constexpr Operators() : m_chars{}, m_size{0} {
+        for (token::TypeInt i = 0; i <= token::type_to_int(token::LAST_TYPE); ++i) {
+            const auto c = token::type_to_char(static_cast<token::Type>(i));
+            if (c != '\0') {
+                m_chars[m_size++] = c;
+            }
+        }
+    }
+
+    constexpr const char* begin() const { return m_chars.data(); }
+    constexpr const char* end() const { return m_chars.data() + m_size; }
+
+private:
+    std::array<char, 256> m_chars;
+    std::size_t m_size;
+};
+
+constexpr Operators operators;
+
+// Besides digits and letters, these are only valid as a part of a number or
+// an identifier.
+constexpr char word_chars[]{'.', '_'};
+
+constexpr bool is_whitespace(char c) {
+    // Same as std::isspace in the "C" locale, which is what \s used to match.
+    return c == ' ' || ('\t' <= c && c <= '\r');
+}
+
+constexpr bool is_operator(char c) {
+    for (const auto op : operators) {
+        if (c == op) {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr bool is_word_char(char c) {
+    for (const auto x : word_chars) {
+        if (c == x) {
+            return true;
+        }
+    }
+    return identifier::is_letter(c);
+}
+
+constexpr unsigned class_bit(Class cls) {
+    return 1u << static_cast<unsigned>(cls);
+}
+
+class ClassTable {
+public:
+    constexpr ClassTable() : m_table{} {
+        for (unsigned i = 0; i < m_table.size(); ++i) {
+            const auto c = static_cast<char>(i);
+            unsigned bits = 0;
+            if (is_whitespace(c)) {
+                bits |= class_bit(Class::WHITESPACE);
+            } else if (number::is_digit(c)) {
+                bits |= class_bit(Class::DIGIT);
+            } else if (is_operator(c)) {
+                bits |= class_bit(Class::OPERATOR);
+            } else if (!is_word_char(c)) {
+                bits |= class_bit(Class::INVALID);
+            }
+            m_table[i] = static_cast<std::uint8_t>(bits);
+        }
+    }
+
+    constexpr unsigned lookup(char c) const { return m_table[static_cast<unsigned char>(c)]; }
+
+private:
+    std::array<std::uint8_t, 256> m_table;
+};
+
+constexpr ClassTable class_table;
+
+// Classifies up to WORD_BITS bytes, producing a word per class.
+using ClassifyWord = void (*)(const char*, Word*);
+
+void classify_scalar(const char* data, std::size_t length, Word* words) {
+    for (std::size_t cls = 0; cls < NUMOF_CLASSES; ++cls) {
+        words[cls] = 0;
+    }
+    for (std::size_t i = 0; i < length; ++i) {
+        const auto bits = class_table.lookup(data[i]);
+        for (std::size_t cls = 0; cls < NUMOF_CLASSES; ++cls) {
+            words[cls] |= static_cast<Word>((bits >> cls) & 1) << i;
+        }
+    }
+}
+
+void classify_word_scalar(const char* data, Word* words) {
+    classify_scalar(data, WORD_BITS, words);
+}
+
+#ifdef MATH_SERVER_HAS_SSE2
+
+// SSE2 has no unsigned comparisons, but lo <= x <= hi is the same as
+// min(x - lo, hi - lo) == x - lo.
+inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+    const auto x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(static_cast<char>(hi - lo))), x);
+}
+
+inline __m128i sse2_any_of(__m128i v, const char* begin, const char* end) {
+    auto result = _mm_setzero_si128();
+    for (auto it = begin; it != end; ++it) {
+        result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8(*it)));
+    }
+    return result;
+}
+
+inline Word sse2_mask(__m128i v) {
+    return static_cast<Word>(static_cast<unsigned>(_mm_movemask_epi8(v)) & 0xffff);
+}
+
+void classify_word_sse2(const char* data, Word* words) {
+    constexpr std::size_t VECTOR_BYTES = 16;
+
+    for (std::size_t cls = 0; cls < NUMOF_CLASSES; ++cls) {
+        words[cls] = 0;
+    }
+    for (std::size_t i = 0; i < WORD_BITS; i += VECTOR_BYTES) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+        const auto ws =
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), sse2_in_range(v, '\t', '\r'));
+        const auto digit = sse2_in_range(v, '0', '9');
+        const auto op = sse2_any_of(v, operators.begin(), operators.end());
+        // Setting bit 5 makes upper case letters lower case.
+        const auto letter = sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+        const auto other = _mm_or_si128(
+            letter, sse2_any_of(v, std::begin(word_chars), std::end(word_chars)));
+        const auto valid = _mm_or_si128(_mm_or_si128(ws, digit), _mm_or_si128(op, other));
+
+        words[static_cast<std::size_t>(Class::WHITESPACE)] |= sse2_mask(ws) << i;
+        words[static_cast<std::size_t>(Class::DIGIT)] |= sse2_mask(digit) << i;
+        words[static_cast<std::size_t>(Class::OPERATOR)] |= sse2_mask(op) << i;
+        words[static_cast<std::size_t>(Class::INVALID)] |= (sse2_mask(valid) ^ 0xffff) << i;
+    }
+}
+
+#endif
+
+#ifdef MATH_SERVER_HAS_AVX2
+
+MATH_SERVER_TARGET_AVX2
+inline __m256i avx2_in_range(__m256i v, char lo, char hi) {
+    const auto x = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(static_cast<char>(hi - lo))),
+                             x);
+}
+
+MATH_SERVER_TARGET_AVX2
+inline __m256i avx2_any_of(__m256i v, const char* begin, const char* end) {
+    auto result = _mm256_setzero_si256();
+    for (auto it = begin; it != end; ++it) {
+        result = _mm256_or_si256(result, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(*it)));
+    }
+    return result;
+}
+
+MATH_SERVER_TARGET_AVX2
+inline Word avx2_mask(__m256i v) {
+    return static_cast<Word>(static_cast<std::uint32_t>(_mm256_movemask_epi8(v)));
+}
+
+MATH_SERVER_TARGET_AVX2
+void classify_word_avx2(const char* data, Word* words) {
+    constexpr std::size_t VECTOR_BYTES = 32;
+
+    for (std::size_t cls = 0; cls < NUMOF_CLASSES; ++cls) {
+        words[cls] = 0;
+    }
+    for (std::size_t i = 0; i < WORD_BITS; i += VECTOR_BYTES) {
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+        const auto ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                        avx2_in_range(v, '\t', '\r'));
+        const auto digit = avx2_in_range(v, '0', '9');
+        const auto op = avx2_any_of(v, operators.begin(), operators.end());
+        const auto letter =
+            avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+        const auto other = _mm256_or_si256(
+            letter, avx2_any_of(v, std::begin(word_chars), std::end(word_chars)));
+        const auto valid =
+            _mm256_or_si256(_mm256_or_si256(ws, digit), _mm256_or_si256(op, other));
+
+        words[static_cast<std::size_t>(Class::WHITESPACE)] |= avx2_mask(ws) << i;
+        words[static_cast<std::size_t>(Class::DIGIT)] |= avx2_mask(digit) << i;
+        words[static_cast<std::size_t>(Class::OPERATOR)] |= avx2_mask(op) << i;
+        words[static_cast<std::size_t>(Class::INVALID)] |= (avx2_mask(valid) ^ 0xffffffff) << i;
+    }
+}
+
+bool cpu_has_avx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    // The OS must save the YMM registers (OSXSAVE + XCR0 bits 1 and 2).
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+Impl best_impl() {
+#if defined(MATH_SERVER_HAS_AVX2)
+    static const bool avx2 = cpu_has_avx2();
+    if (avx2) {
+        return Impl::AVX2;
+    }
+#endif
+#if defined(MATH_SERVER_HAS_SSE2)
+    return Impl::SSE2;
+#else
+    return Impl::SCALAR;
+#endif
+}
+
+ClassifyWord get_classify_word(Impl impl) {
+    switch (impl) {
+        case Impl::SCALAR:
+            return &classify_word_scalar;
+#ifdef MATH_SERVER_HAS_SSE2
+        case Impl::SSE2:
+            return &classify_word_sse2;
+#endif
+#ifdef MATH_SERVER_HAS_AVX2
+        case Impl::AVX2:
+            return &classify_word_avx2;
+#endif
+        default:
+            throw LexerError{"internal: unsupported character classification routine"};
+    }
+}
+
+unsigned count_trailing_zeros(Word x) {
+    // x must not be 0.
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    for (; (x & 1) == 0; x >>= 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+} // namespace
+
+bool CharMap::is_supported(Impl impl) {
+    switch (impl) {
+        case Impl::AUTO:
+        case Impl::SCALAR:
+            return true;
+#ifdef MATH_SERVER_HAS_SSE2
+        case Impl::SSE2:
+            return true;
+#endif
+#ifdef MATH_SERVER_HAS_AVX2
+        case Impl::AVX2:
+            return best_impl() == Impl::AVX2;
+#endif
+        default:
+            return false;
+    }
+}
+
+CharMap::CharMap(const std::string_view& input, Impl impl) {
+    assign(input, impl);
+}
+
+void CharMap::assign(const std::string_view& input, Impl impl) {
+    m_length = input.length();
+    m_words = (input.length() + WORD_BITS - 1) / WORD_BITS;
+
+    if (impl == Impl::AUTO) {
+        impl = best_impl();
+    }
+    if (!is_supported(impl)) {
+        throw LexerError{"internal: unsupported character classification routine"};
+    }
+    const auto classify_word = get_classify_word(impl);
+
+    m_bits.resize(NUMOF_CLASSES * m_words);
+
+    Word words[NUMOF_CLASSES];
+    for (std::size_t i = 0; i < m_words; ++i) {
+        const auto offset = i * WORD_BITS;
+        const auto remaining = m_length - offset;
+        if (remaining >= WORD_BITS) {
+            classify_word(input.data() + offset, words);
+        } else {
+            classify_scalar(input.data() + offset, remaining, words);
+        }
+        for (std::size_t cls = 0; cls < NUMOF_CLASSES; ++cls) {
+            m_bits[cls * m_words + i] = words[cls];
+        }
+    }
+}
+
+std::size_t CharMap::skip_whitespace(std::size_t pos) const {
+    const auto ws = plane(Class::WHITESPACE);
+    for (auto i = pos / WORD_BITS; i < m_words; ++i) {
+        auto word = ~ws[i];
+        if (i == pos / WORD_BITS) {
+            word &= ~Word{0} << (pos % WORD_BITS);
+        }
+        if (word != 0) {
+            const auto result = i * WORD_BITS + count_trailing_zeros(word);
+            return result < m_length ? result : m_length;
+        }
+    }
+    return m_length;
+}
+
+std::size_t CharMap::find_invalid() const {
+    const auto invalid = plane(Class::INVALID);
+    for (std::size_t i = 0; i < m_words; ++i) {
+        if (invalid[i] != 0) {
+            return i * WORD_BITS + count_trailing_zeros(invalid[i]);
+        }
+    }
+    return npos;
+}
+
+} // namespace math::server::lexer::details
@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace math::server::lexer::details {
+
+// A single pass over the whole input, classifying every byte.
+// Lets the lexer skip runs of whitespace and reject garbage without trying to
+// tokenize it first.
+
+class CharMap {
+public:
+    enum class Class {
+        WHITESPACE,
+        DIGIT,
+        OPERATOR,
+        // Neither of the above, and can't be a part of a number or an
+        // identifier either.
+        INVALID,
+    };
+
+    enum class Impl {
+        // The fastest one supported by the CPU.
+        AUTO,
+        SCALAR,
+        SSE2,
+        AVX2,
+    };
+
+    static bool is_supported(Impl);
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    explicit CharMap(const std::string_view& input, Impl impl = Impl::AUTO);
+
+    // Classifies another input, reusing the memory.
+    void assign(const std::string_view& input, Impl impl = Impl::AUTO);
+
+    std::size_t get_length() const { return m_length; }
+
+    bool test(Class cls, std::size_t pos) const {
+        return (plane(cls)[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1;
+    }
+
+    // Position of the first non-whitespace byte at or after pos (or the
+    // length of the input).
+    std::size_t skip_whitespace(std::size_t pos) const;
+
+    // Position of the first invalid byte (or npos).
+    std::size_t find_invalid() const;
+
+    bool operator==(const CharMap& other) const {
+        return m_length == other.m_length && m_bits == other.m_bits;
+    }
+    bool operator!=(const CharMap& other) const { return !(*this == other); }
+
+    using Word = std::uint64_t;
+    static constexpr std::size_t WORD_BITS = 64;
+
+private:
+    static constexpr std::size_t NUMOF_CLASSES = 4;
+
+    const Word* plane(Class cls) const {
+        return m_bits.data() + static_cast<std::size_t>(cls) * m_words;
+    }
+
+    std::size_t m_length;
+    std::size_t m_words;
+    // All the planes (one per class) back to back.
+    std::vector<Word> m_bits;
+};
+
+} // namespace math::server::lexer::details
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace math::server::lexer::details::identifier {
+
+// Variable names, as in C: [A-Za-z_][A-Za-z0-9_]*
+// Numbers are matched first, so "1e5" is a number and "e5" is an identifier.
+
+constexpr bool is_letter(char c) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+}
+
+constexpr bool is_first(char c) {
+    return is_letter(c) || c == '_';
+}
+
+constexpr bool is_next(char c) {
+    return is_first(c) || ('0' <= c && c <= '9');
+}
+
+// The number of characters that can continue an identifier at the start of
+// the input.
+constexpr std::size_t skip(const std::string_view& input) {
+    std::size_t length = 0;
+    while (length < input.length() && is_next(input[length])) {
+        ++length;
+    }
+    return length;
+}
+
+// The length of the identifier at the start of the input (0 if there's none).
+constexpr std::size_t scan(const std::string_view& input) {
+    if (input.empty() || !is_first(input.front())) {
+        return 0;
+    }
+    return 1 + skip(input.substr(1));
+}
+
+} // namespace math::server::lexer::details::identifier
@@ -0,0 +1,141 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace math::server::lexer::details::number {
+
+// A hand-written DFA for the same grammar as NUMBER_REGEX in parse.cpp:
+//
+//     (?:\d+(?:\.\d*)?|\.\d+)(e[+-]?(\d*))?
+//
+// The 'e' is case-insensitive.
+// It's a DFA and not a "scan until a non-digit" loop so that the lexer can be
+// fed one byte at a time if it needs to be.
+
+enum class State : unsigned char {
+    START,
+    INTEGER,    // \d+
+    DOT,        // \. (not a number yet)
+    FRACTION,   // \d+\.\d* or \.\d+
+    EXP,        // ...e
+    EXP_SIGN,   // ...e[+-]
+    EXP_DIGITS, // ...e[+-]?\d+
+    REJECT,
+};
+
+constexpr bool is_digit(char c) {
+    return '0' <= c && c <= '9';
+}
+
+constexpr bool is_exp(char c) {
+    return c == 'e' || c == 'E';
+}
+
+constexpr bool is_sign(char c) {
+    return c == '+' || c == '-';
+}
+
+constexpr State step(State state, char c) {
+    switch (state) {
+        case State::START:
+            if (is_digit(c)) {
+                return State::INTEGER;
+            }
+            if (c == '.') {
+                return State::DOT;
+            }
+            return State::REJECT;
+
+        case State::INTEGER:
+            if (is_digit(c)) {
+                return State::INTEGER;
+            }
+            if (c == '.') {
+                return State::FRACTION;
+            }
+            if (is_exp(c)) {
+                return State::EXP;
+            }
+            return State::REJECT;
+
+        case State::DOT:
+            if (is_digit(c)) {
+                return State::FRACTION;
+            }
+            return State::REJECT;
+
+        case State::FRACTION:
+            if (is_digit(c)) {
+                return State::FRACTION;
+            }
+            if (is_exp(c)) {
+                return State::EXP;
+            }
+            return State::REJECT;
+
+        case State::EXP:
+            if (is_sign(c)) {
+                return State::EXP_SIGN;
+            }
+            if (is_digit(c)) {
+                return State::EXP_DIGITS;
+            }
+            return State::REJECT;
+
+        case State::EXP_SIGN:
+        case State::EXP_DIGITS:
+            if (is_digit(c)) {
+                return State::EXP_DIGITS;
+            }
+            return State::REJECT;
+
+        default:
+            return State::REJECT;
+    }
+}
+
+constexpr bool is_accepting(State state) {
+    switch (state) {
+        case State::INTEGER:
+        case State::FRACTION:
+        case State::EXP_DIGITS:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// If we have the numeric part of a number followed by 'e' and no digits,
+// 1) that 'e' definitely belongs to this number token,
+// 2) the user forgot to type in the required digits.
+constexpr bool is_exponent_without_digits(State state) {
+    return state == State::EXP || state == State::EXP_SIGN;
+}
+
+struct Match {
+    State state;
+    std::size_t length;
+};
+
+// Runs the DFA until it rejects a character or the input runs out.
+constexpr Match scan(const std::string_view& input) {
+    auto state = State::START;
+    std::size_t length = 0;
+    for (; length < input.length(); ++length) {
+        const auto next = step(state, input[length]);
+        if (next == State::REJECT) {
+            break;
+        }
+        state = next;
+    }
+    return {state, length};
+}
+
+} // namespace math::server::lexer::details::number
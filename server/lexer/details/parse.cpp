@@ -3,13 +3,20 @@
 // For details, see https://github.com/egor-tensin/math-server.
 // Distributed under the MIT License.
 
+#include "number.hpp"
+
+#include <common/result.hpp>
 #include <lexer/error.hpp>
 #include <lexer/token_type.hpp>
 
 #include <boost/regex.hpp>
 
+#include <array>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <limits>
 #include <optional>
 #include <regex>
 #include <string>
@@ -59,7 +66,7 @@ public:
 protected:
     // This is a hacky attempt to describe a C-like grammar for floating-point
     // numbers using a regex (the tests seem to pass though).
-    // A proper NFA would be better, I guess.
+    // See number.hpp for a proper DFA, which is what the lexer actually uses.
     static constexpr std::string_view NUMBER_REGEX{
         R"REGEX(^(?:\d+(?:\.\d*)?|\.\d+)(e[+-]?(\d*))?)REGEX"};
 
@@ -121,6 +128,49 @@ std::optional<double> parse_number(const std::string_view& input,
     return {};
 }
 
+// Integers this long always fit into a double exactly.
+constexpr std::size_t MAX_EXACT_INTEGER_DIGITS = 15;
+
+double integer_to_double(const std::string_view& digits) {
+    std::uint64_t result = 0;
+    for (const auto c : digits) {
+        result = result * 10 + static_cast<unsigned>(c - '0');
+    }
+    return static_cast<double>(result);
+}
+
+Result<double> to_double(const std::string_view& view, number::State state) {
+    if (state == number::State::INTEGER && view.length() <= MAX_EXACT_INTEGER_DIGITS) {
+        return integer_to_double(view);
+    }
+    // std::from_chars doesn't allocate, doesn't depend on the current locale
+    // and is required to round correctly, unlike std::stod.
+    double result = 0;
+    const auto end = view.data() + view.length();
+    const auto [ptr, ec] = std::from_chars(view.data(), end, result);
+    if (ec != std::errc{} || ptr != end) {
+        return ErrorInfo{ErrorInfo::Source::LEXER, "internal: couldn't parse number from", view};
+    }
+    return result;
+}
+
+Result<std::optional<double>> scan_number(const std::string_view& input, std::string_view& token) {
+    const auto match = number::scan(input);
+    const auto view = input.substr(0, match.length);
+    if (number::is_exponent_without_digits(match.state)) {
+        return ErrorInfo{ErrorInfo::Source::LEXER, "exponent has no digits", view};
+    }
+    if (!number::is_accepting(match.state)) {
+        return std::optional<double>{};
+    }
+    const auto result = to_double(view, match.state);
+    if (!result) {
+        return result.error();
+    }
+    token = view;
+    return std::optional<double>{*result};
+}
+
 template <typename MatchResultsT>
 class RegexWhitespaceMatcher : public RegexMatcher<MatchResultsT> {
 protected:
@@ -170,6 +220,38 @@ bool starts_with(const std::string_view& a, const std::string_view& b) noexcept
     return a.length() >= b.length() && a.compare(0, b.length(), b) == 0;
 }
 
+// Maps the first byte of the input to a constant token type (if any).
+class ConstTokenTable {
+public:
+    constexpr ConstTokenTable() : m_table{} {
+        for (auto& entry : m_table) {
+            entry = NONE;
+        }
+        for (token::TypeInt i = 0; i <= token::type_to_int(token::LAST_TYPE); ++i) {
+            const auto type = static_cast<token::Type>(i);
+            const auto c = token::type_to_char(type);
+            if (c != '\0') {
+                m_table[static_cast<unsigned char>(c)] = static_cast<std::uint8_t>(i);
+            }
+        }
+    }
+
+    constexpr std::optional<token::Type> lookup(char c) const {
+        const auto entry = m_table[static_cast<unsigned char>(c)];
+        if (entry == NONE) {
+            return {};
+        }
+        return static_cast<token::Type>(entry);
+    }
+
+private:
+    static constexpr std::uint8_t NONE = std::numeric_limits<std::uint8_t>::max();
+
+    std::array<std::uint8_t, 256> m_table;
+};
+
+constexpr ConstTokenTable const_token_table;
+
 } // namespace
 
 namespace impl {
@@ -192,6 +274,53 @@ std::optional<double> boost_parse_number(const std::string_view& input) {
     return boost_parse_number(input, token);
 }
 
+std::optional<double> dfa_parse_number(const std::string_view& input, std::string_view& token) {
+    const auto result = scan_number(input, token);
+    if (!result) {
+        throw LexerError{result.error()};
+    }
+    return *result;
+}
+
+std::optional<double> dfa_parse_number(const std::string_view& input) {
+    std::string_view token;
+    return dfa_parse_number(input, token);
+}
+
+std::optional<token::Type> set_parse_const_token(const std::string_view& input,
+                                                 std::string_view& token) {
+    for (const auto type : token::const_tokens()) {
+        const auto str = token::type_to_string(type);
+        if (starts_with(input, str)) {
+            token = std::string_view(input.data(), str.length());
+            return {type};
+        }
+    }
+    return {};
+}
+
+std::optional<token::Type> set_parse_const_token(const std::string_view& input) {
+    std::string_view token;
+    return set_parse_const_token(input, token);
+}
+
+std::optional<token::Type> table_parse_const_token(const std::string_view& input,
+                                                   std::string_view& token) {
+    if (input.empty()) {
+        return {};
+    }
+    const auto type = const_token_table.lookup(input.front());
+    if (type.has_value()) {
+        token = input.substr(0, 1);
+    }
+    return type;
+}
+
+std::optional<token::Type> table_parse_const_token(const std::string_view& input) {
+    std::string_view token;
+    return table_parse_const_token(input, token);
+}
+
 std::string_view std_parse_whitespace(const std::string_view& input) {
     return parse_whitespace(input, StdWhitespaceMatcher{});
 }
@@ -202,8 +331,13 @@ std::string_view boost_parse_whitespace(const std::string_view& input) {
 
 } // namespace impl
 
+Result<std::optional<double>> try_parse_number(const std::string_view& input,
+                                               std::string_view& token) {
+    return scan_number(input, token);
+}
+
 std::optional<double> parse_number(const std::string_view& input, std::string_view& token) {
-    return impl::boost_parse_number(input, token);
+    return impl::dfa_parse_number(input, token);
 }
 
 std::optional<double> parse_number(const std::string_view& input) {
@@ -213,14 +347,7 @@ std::optional<double> parse_number(const std::string_view& input) {
 
 std::optional<token::Type> parse_const_token(const std::string_view& input,
                                              std::string_view& token) {
-    for (const auto type : token::const_tokens()) {
-        const auto str = token::type_to_string(type);
-        if (starts_with(input, str)) {
-            token = std::string_view(input.data(), str.length());
-            return {type};
-        }
-    }
-    return {};
+    return impl::table_parse_const_token(input, token);
 }
 
 std::optional<token::Type> parse_const_token(const std::string_view& input) {
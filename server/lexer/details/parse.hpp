@@ -7,6 +7,8 @@
 
 #include "../token_type.hpp"
 
+#include <common/result.hpp>
+
 #include <optional>
 #include <string_view>
 
@@ -19,12 +21,22 @@ std::optional<double> std_parse_number(const std::string_view&, std::string_view
 std::optional<double> std_parse_number(const std::string_view&);
 std::optional<double> boost_parse_number(const std::string_view&, std::string_view&);
 std::optional<double> boost_parse_number(const std::string_view&);
+std::optional<double> dfa_parse_number(const std::string_view&, std::string_view&);
+std::optional<double> dfa_parse_number(const std::string_view&);
+
+std::optional<token::Type> set_parse_const_token(const std::string_view&, std::string_view&);
+std::optional<token::Type> set_parse_const_token(const std::string_view&);
+std::optional<token::Type> table_parse_const_token(const std::string_view&, std::string_view&);
+std::optional<token::Type> table_parse_const_token(const std::string_view&);
 
 std::string_view std_parse_whitespace(const std::string_view&);
 std::string_view boost_parse_whitespace(const std::string_view&);
 
 } // namespace impl
 
+// Doesn't throw on malformed numbers:
+Result<std::optional<double>> try_parse_number(const std::string_view&, std::string_view&);
+
 // Exposed for testing:
 std::string_view parse_whitespace(const std::string_view&);
 std::optional<double> parse_number(const std::string_view&, std::string_view&);
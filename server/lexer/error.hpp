@@ -6,6 +6,7 @@
 #pragma once
 
 #include <common/error.hpp>
+#include <common/result.hpp>
 
 #include <string>
 
@@ -14,6 +15,7 @@ namespace math::server {
 class LexerError : public Error {
 public:
     explicit LexerError(const std::string& what) : Error{"lexer error: " + what} {}
+    explicit LexerError(const ErrorInfo& info) : LexerError{info.get_message()} {}
 };
 
 } // namespace math::server
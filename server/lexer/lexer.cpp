@@ -3,12 +3,17 @@
 // For details, see https://github.com/egor-tensin/math-server.
 // Distributed under the MIT License.
 
+#include <common/result.hpp>
+#include <lexer/details/classify.hpp>
+#include <lexer/details/identifier.hpp>
 #include <lexer/details/parse.hpp>
 #include <lexer/error.hpp>
 #include <lexer/lexer.hpp>
 #include <lexer/token.hpp>
+#include <lexer/token_buffer.hpp>
 #include <lexer/token_type.hpp>
 
+#include <cstddef>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -16,13 +21,45 @@
 #include <vector>
 
 namespace math::server {
+namespace {
+
+const lexer::details::CharMap& classify(lexer::details::CharMap& char_map,
+                                        const std::string_view& input) {
+    char_map.assign(input);
+    return char_map;
+}
+
+// Token positions have to fit into TokenBuffer's offsets.
+Status check_length(std::size_t length) {
+    if (length > lexer::TokenBuffer::MAX_INPUT_LENGTH) {
+        return ErrorInfo{ErrorInfo::Source::LEXER, "input is too long"};
+    }
+    return success();
+}
+
+} // namespace
 
 Lexer::Lexer(const std::string_view& input) : Lexer{lexer::Input{input}} {}
 
-Lexer::Lexer(const lexer::Input& input) : m_input{input} {
+Lexer::Lexer(const lexer::Input& input) : Lexer{input, Unchecked{}} {
+    if (const auto status = check_input(); !status) {
+        throw LexerError{status.error()};
+    }
     consume_token();
 }
 
+Lexer::Lexer(const lexer::Input& input, Unchecked)
+    : m_input{input},
+      m_own_char_map{input.get_input()},
+      m_char_map{m_own_char_map},
+      m_char_map_base{input.get_pos()} {}
+
+Lexer::Lexer(const lexer::Input& input, lexer::details::CharMap& char_map, Unchecked)
+    : m_input{input},
+      m_own_char_map{{}},
+      m_char_map{classify(char_map, input.get_input())},
+      m_char_map_base{input.get_pos()} {}
+
 bool Lexer::for_each_token(const TokenProcessor& process) {
     for (auto token = peek_token(); token.has_value(); drop_token(), token = peek_token()) {
         if (!process(*token)) {
@@ -41,6 +78,69 @@ std::vector<Lexer::ParsedToken> Lexer::get_tokens() {
     return tokens;
 }
 
+void Lexer::tokenize_all(lexer::TokenBuffer& tokens) {
+    tokens.clear();
+    if (const auto status = check_length(m_input.get_pos() + m_input.get_length()); !status) {
+        throw LexerError{status.error()};
+    }
+    if (m_token_buffer.has_value()) {
+        const auto& token = *m_token_buffer;
+        if (token.get_type() == Type::NUMBER) {
+            tokens.add_number(token.as_number(), token.get_pos());
+        } else if (token.get_type() == Type::IDENTIFIER) {
+            tokens.add_identifier(token.get_view(), token.get_pos());
+        } else {
+            tokens.add(token.get_type(), token.get_pos());
+        }
+        m_token_buffer = {};
+    }
+    if (const auto status = tokenize_rest(tokens); !status) {
+        throw LexerError{status.error()};
+    }
+}
+
+Status Lexer::try_tokenize_all(const std::string_view& input, lexer::TokenBuffer& tokens) {
+    tokens.clear();
+    // Checked before the input is even classified.
+    if (const auto status = check_length(input.length()); !status) {
+        return status;
+    }
+    Lexer lexer{lexer::Input{input}, tokens.get_char_map(), Unchecked{}};
+    if (const auto status = lexer.check_input(); !status) {
+        return status;
+    }
+    return lexer.tokenize_rest(tokens);
+}
+
+Status Lexer::tokenize_rest(lexer::TokenBuffer& tokens) {
+    // Same as consume_token, minus the ParsedToken overhead.
+    for (consume_whitespace(); !m_input.empty(); consume_whitespace()) {
+        const auto pos = m_input.get_pos();
+        std::string_view view;
+        if (const auto type = lexer::details::parse_const_token(m_input.get_input(), view);
+            type.has_value()) {
+            tokens.add(*type, pos);
+        } else {
+            const auto number = lexer::details::try_parse_number(m_input.get_input(), view);
+            if (!number) {
+                return number.error();
+            }
+            if (number->has_value()) {
+                tokens.add_number(**number, pos);
+            } else {
+                const auto length = lexer::details::identifier::scan(m_input.get_input());
+                if (length == 0) {
+                    return invalid_input();
+                }
+                view = m_input.get_input().substr(0, length);
+                tokens.add_identifier(view, pos);
+            }
+        }
+        m_input.consume(view);
+    }
+    return success();
+}
+
 void Lexer::drop_token() {
     if (!has_token()) {
         throw LexerError{"internal: no tokens to drop"};
@@ -61,12 +161,23 @@ std::optional<Lexer::ParsedToken> Lexer::drop_token_of_type(Type type) {
     return result;
 }
 
-void Lexer::consume_whitespace() {
-    const auto ws = parse_whitespace();
-    if (!ws.has_value()) {
-        return;
+Status Lexer::check_input() const {
+    // Don't bother tokenizing the input if it contains a byte which can't be a
+    // part of any token.
+    const auto pos = m_char_map.find_invalid();
+    if (pos == lexer::details::CharMap::npos) {
+        return success();
     }
-    m_input.consume(ws->get_length());
+    return ErrorInfo{ErrorInfo::Source::LEXER, "invalid input at", m_input.get_input().substr(pos)};
+}
+
+ErrorInfo Lexer::invalid_input() const {
+    return {ErrorInfo::Source::LEXER, "invalid input at", m_input.get_input()};
+}
+
+void Lexer::consume_whitespace() {
+    const auto pos = m_input.get_pos() - m_char_map_base;
+    m_input.consume(m_char_map.skip_whitespace(pos) - pos);
 }
 
 void Lexer::consume_token() {
@@ -82,14 +193,6 @@ void Lexer::consume_token() {
     m_token_buffer = std::move(token);
 }
 
-std::optional<Lexer::ParsedToken> Lexer::parse_whitespace() const {
-    const auto token_view = lexer::details::parse_whitespace(m_input.get_input());
-    if (token_view.empty()) {
-        return {};
-    }
-    return ParsedToken{Token{Token::Type::WHITESPACE}, m_input.get_pos(), token_view};
-}
-
 std::optional<Lexer::ParsedToken> Lexer::parse_const_token() const {
     std::string_view token_view;
     const auto type = lexer::details::parse_const_token(m_input.get_input(), token_view);
@@ -101,11 +204,23 @@ std::optional<Lexer::ParsedToken> Lexer::parse_const_token() const {
 
 std::optional<Lexer::ParsedToken> Lexer::parse_number() const {
     std::string_view token_view;
-    const auto number = lexer::details::parse_number(m_input.get_input(), token_view);
-    if (!number.has_value()) {
+    const auto number = lexer::details::try_parse_number(m_input.get_input(), token_view);
+    if (!number) {
+        throw LexerError{number.error()};
+    }
+    if (!number->has_value()) {
         return {};
     }
-    return ParsedToken{Token{*number}, m_input.get_pos(), token_view};
+    return ParsedToken{Token{**number}, m_input.get_pos(), token_view};
+}
+
+std::optional<Lexer::ParsedToken> Lexer::parse_identifier() const {
+    const auto length = lexer::details::identifier::scan(m_input.get_input());
+    if (length == 0) {
+        return {};
+    }
+    const auto token_view = m_input.get_input().substr(0, length);
+    return ParsedToken{Token{token_view}, m_input.get_pos(), token_view};
 }
 
 Lexer::ParsedToken Lexer::parse_token() const {
@@ -115,7 +230,10 @@ Lexer::ParsedToken Lexer::parse_token() const {
     if (const auto number = parse_number(); number.has_value()) {
         return *number;
     }
-    throw LexerError{"invalid input at: " + std::string{m_input.get_input()}};
+    if (const auto identifier = parse_identifier(); identifier.has_value()) {
+        return *identifier;
+    }
+    throw LexerError{invalid_input()};
 }
 
 } // namespace math::server
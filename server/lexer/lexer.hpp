@@ -5,10 +5,15 @@
 
 #pragma once
 
+#include "details/classify.hpp"
 #include "input.hpp"
 #include "token.hpp"
+#include "token_buffer.hpp"
 #include "token_type.hpp"
 
+#include <common/result.hpp>
+
+#include <cstddef>
 #include <functional>
 #include <optional>
 #include <string_view>
@@ -21,6 +26,9 @@ public:
     explicit Lexer(const std::string_view& input);
     explicit Lexer(const lexer::Input& input);
 
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+
     using Token = lexer::Token;
     using ParsedToken = lexer::ParsedToken;
     using Type = Token::Type;
@@ -30,6 +38,12 @@ public:
 
     std::vector<ParsedToken> get_tokens();
 
+    // Consumes the rest of the input, replacing the contents of the buffer.
+    void tokenize_all(lexer::TokenBuffer&);
+
+    // Same, but reports invalid input without throwing.
+    static Status try_tokenize_all(const std::string_view& input, lexer::TokenBuffer&);
+
     bool has_token() const { return peek_token().has_value(); }
 
     std::optional<ParsedToken> peek_token() const { return m_token_buffer; }
@@ -38,9 +52,20 @@ public:
     std::optional<ParsedToken> drop_token_of_type(Type type);
 
 private:
-    std::optional<ParsedToken> parse_whitespace() const;
+    struct Unchecked {};
+
+    Lexer(const lexer::Input& input, Unchecked);
+    // Classifies the input using the caller's memory.
+    Lexer(const lexer::Input& input, lexer::details::CharMap&, Unchecked);
+
+    Status check_input() const;
+    ErrorInfo invalid_input() const;
+
+    Status tokenize_rest(lexer::TokenBuffer&);
+
     std::optional<ParsedToken> parse_const_token() const;
     std::optional<ParsedToken> parse_number() const;
+    std::optional<ParsedToken> parse_identifier() const;
 
     ParsedToken parse_token() const;
 
@@ -48,6 +73,11 @@ private:
     void consume_token();
 
     lexer::Input m_input;
+    // Unused if the caller provides the memory.
+    lexer::details::CharMap m_own_char_map;
+    // Classification of the input, starting at position m_char_map_base.
+    const lexer::details::CharMap& m_char_map;
+    const std::size_t m_char_map_base;
     std::optional<ParsedToken> m_token_buffer;
 };
 
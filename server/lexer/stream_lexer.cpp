@@ -0,0 +1,216 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <common/result.hpp>
+#include <lexer/details/classify.hpp>
+#include <lexer/details/identifier.hpp>
+#include <lexer/details/number.hpp>
+#include <lexer/details/parse.hpp>
+#include <lexer/stream_lexer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+
+namespace math::server {
+
+using lexer::details::CharMap;
+namespace identifier = lexer::details::identifier;
+namespace number = lexer::details::number;
+
+void StreamLexer::reset() {
+    m_number_state = number::State::START;
+    m_number.clear();
+    m_identifier.clear();
+    m_error = nullptr;
+    m_invalid_byte = false;
+    m_context.clear();
+    m_capturing = false;
+}
+
+void StreamLexer::feed(const std::string_view& chunk) {
+    if (m_capturing) {
+        capture(chunk);
+    }
+    if (m_invalid_byte) {
+        return;
+    }
+
+    m_char_map.assign(chunk);
+    const auto invalid = m_char_map.find_invalid();
+    if (m_error == nullptr) {
+        tokenize(chunk.substr(0, invalid));
+    }
+    if (invalid != CharMap::npos) {
+        // Same as Lexer::check_input.
+        m_error = nullptr;
+        fail("invalid input at", {});
+        m_invalid_byte = true;
+        capture(chunk.substr(invalid));
+    }
+}
+
+Status StreamLexer::finish() {
+    if (m_error == nullptr && m_number_state != number::State::START) {
+        flush_number({});
+    }
+    if (m_error == nullptr && !m_identifier.empty()) {
+        flush_identifier();
+    }
+    if (m_error != nullptr) {
+        return ErrorInfo{ErrorInfo::Source::LEXER, m_error, m_context};
+    }
+    return success();
+}
+
+void StreamLexer::tokenize(const std::string_view& chunk) {
+    std::size_t pos = 0;
+    if (m_number_state != number::State::START) {
+        pos = continue_number(chunk);
+    } else if (!m_identifier.empty()) {
+        pos = continue_identifier(chunk);
+    }
+    while (m_error == nullptr) {
+        pos = std::min(m_char_map.skip_whitespace(pos), chunk.length());
+        if (pos == chunk.length()) {
+            break;
+        }
+        const auto rest = chunk.substr(pos);
+
+        std::string_view token;
+        if (const auto type = lexer::details::parse_const_token(rest, token); type.has_value()) {
+            m_sink.on_token(*type);
+            pos += token.length();
+            continue;
+        }
+
+        if (const auto length = identifier::scan(rest); length != 0) {
+            if (length == rest.length()) {
+                // Might be continued in the next chunk.
+                m_identifier.assign(rest);
+                check_identifier_length();
+                break;
+            }
+            m_sink.on_identifier(rest.substr(0, length));
+            pos += length;
+            continue;
+        }
+
+        const auto match = number::scan(rest);
+        if (match.length == rest.length()) {
+            // Might be continued in the next chunk.
+            m_number_state = match.state;
+            m_number.assign(rest);
+            check_number_length();
+            break;
+        }
+        pos += parse_number(rest, {});
+    }
+}
+
+std::size_t StreamLexer::continue_number(const std::string_view& chunk) {
+    auto state = m_number_state;
+    std::size_t pos = 0;
+    for (; pos < chunk.length(); ++pos) {
+        const auto next = number::step(state, chunk[pos]);
+        if (next == number::State::REJECT) {
+            break;
+        }
+        state = next;
+    }
+    m_number_state = state;
+    m_number.append(chunk.substr(0, pos));
+
+    if (!check_number_length()) {
+        return pos;
+    }
+    if (pos < chunk.length()) {
+        flush_number(chunk.substr(pos));
+    }
+    return pos;
+}
+
+bool StreamLexer::check_number_length() {
+    if (m_number.length() <= MAX_NUMBER_LENGTH) {
+        return true;
+    }
+    fail("number is too long", m_number);
+    m_capturing = false;
+    return false;
+}
+
+void StreamLexer::flush_number(const std::string_view& rest) {
+    m_number_state = number::State::START;
+    parse_number(m_number, rest);
+    m_number.clear();
+}
+
+std::size_t StreamLexer::parse_number(const std::string_view& number,
+                                      const std::string_view& rest) {
+    std::string_view token;
+    const auto result = lexer::details::try_parse_number(number, token);
+    if (!result) {
+        fail(result.error().get_msg(), result.error().get_context());
+        m_capturing = false;
+        return 0;
+    }
+    if (!result->has_value()) {
+        // Same as Lexer::invalid_input, the context is the rest of the input.
+        fail("invalid input at", number);
+        capture(rest);
+        return 0;
+    }
+    m_sink.on_number(**result);
+    return token.length();
+}
+
+std::size_t StreamLexer::continue_identifier(const std::string_view& chunk) {
+    const auto length = identifier::skip(chunk);
+    m_identifier.append(chunk.substr(0, length));
+
+    if (!check_identifier_length()) {
+        return length;
+    }
+    if (length < chunk.length()) {
+        flush_identifier();
+    }
+    return length;
+}
+
+bool StreamLexer::check_identifier_length() {
+    if (m_identifier.length() <= MAX_IDENTIFIER_LENGTH) {
+        return true;
+    }
+    fail("identifier is too long", m_identifier);
+    m_capturing = false;
+    return false;
+}
+
+void StreamLexer::flush_identifier() {
+    m_sink.on_identifier(m_identifier);
+    m_identifier.clear();
+}
+
+void StreamLexer::fail(const char* msg, const std::string_view& context) {
+    if (m_error != nullptr) {
+        return;
+    }
+    m_error = msg;
+    m_context.clear();
+    m_capturing = true;
+    capture(context);
+}
+
+void StreamLexer::capture(const std::string_view& input) {
+    // One extra byte lets ErrorInfo know the context was truncated.
+    static constexpr auto max_length = ErrorInfo::MAX_CONTEXT_LENGTH + 1;
+    const auto length = std::min(input.length(), max_length - m_context.length());
+    m_context.append(input.substr(0, length));
+    if (m_context.length() == max_length) {
+        m_capturing = false;
+    }
+}
+
+} // namespace math::server
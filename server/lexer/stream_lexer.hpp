@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "details/classify.hpp"
+#include "details/number.hpp"
+#include "token.hpp"
+#include "token_type.hpp"
+
+#include <common/result.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace math::server {
+
+// Tokenizes input that arrives in chunks (e.g. from a socket), without
+// buffering all of it.
+// Tokens are passed to the sink as soon as they're complete; the only thing
+// that's buffered is a number split between chunks.
+// Errors are the same as Lexer's: an invalid byte anywhere in the input takes
+// precedence over a malformed token before it.
+
+class StreamLexer {
+public:
+    using Type = lexer::Token::Type;
+
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+
+        // Anything but a number or an identifier.
+        virtual void on_token(Type) = 0;
+        virtual void on_number(double) = 0;
+        // The name is only valid for the duration of the call.
+        virtual void on_identifier(const std::string_view& name) = 0;
+    };
+
+    // Limits the memory used for a token split between chunks.
+    static constexpr std::size_t MAX_NUMBER_LENGTH = 1024;
+    static constexpr std::size_t MAX_IDENTIFIER_LENGTH = 1024;
+
+    explicit StreamLexer(Sink& sink) : m_sink{sink}, m_char_map{{}} {}
+
+    StreamLexer(const StreamLexer&) = delete;
+    StreamLexer& operator=(const StreamLexer&) = delete;
+
+    // Readies the lexer for another input.
+    void reset();
+
+    void feed(const std::string_view& chunk);
+
+    // Signals the end of input.
+    // The error (if any) is valid until the next reset().
+    Status finish();
+
+private:
+    void tokenize(const std::string_view& chunk);
+
+    // Returns the number of bytes consumed.
+    std::size_t continue_number(const std::string_view& chunk);
+    bool check_number_length();
+    void flush_number(const std::string_view& rest);
+
+    // Returns the length of the number at the start of the input.
+    std::size_t parse_number(const std::string_view& number, const std::string_view& rest);
+
+    // Returns the number of bytes consumed.
+    std::size_t continue_identifier(const std::string_view& chunk);
+    bool check_identifier_length();
+    void flush_identifier();
+
+    void fail(const char* msg, const std::string_view& context);
+    void capture(const std::string_view&);
+
+    Sink& m_sink;
+
+    lexer::details::CharMap m_char_map;
+
+    lexer::details::number::State m_number_state = lexer::details::number::State::START;
+    std::string m_number;
+    // Not empty if there's an identifier which might be continued in the next
+    // chunk.
+    std::string m_identifier;
+
+    const char* m_error = nullptr;
+    bool m_invalid_byte = false;
+    // Error context, which might span several chunks.
+    std::string m_context;
+    bool m_capturing = false;
+};
+
+} // namespace math::server
@@ -9,6 +9,8 @@
 
 #include <cmath>
 #include <limits>
+#include <string>
+#include <string_view>
 #include <variant>
 
 namespace math::server::lexer {
@@ -39,6 +41,9 @@ Token::Token(Type type) : m_type{type} {
 
 Token::Token(double value) : m_type{Type::NUMBER}, m_value{value} {}
 
+Token::Token(const std::string_view& identifier)
+    : m_type{Type::IDENTIFIER}, m_value{std::string{identifier}} {}
+
 bool Token::operator==(const Token& other) const {
     if (m_type != other.m_type) {
         return false;
@@ -49,6 +54,9 @@ bool Token::operator==(const Token& other) const {
     if (m_type == Type::NUMBER) {
         return numbers_equal(as_number(), other.as_number());
     }
+    if (m_type == Type::IDENTIFIER) {
+        return as_identifier() == other.as_identifier();
+    }
     throw LexerError{"internal: can't compare tokens of type: " +
                      token::type_to_int_string(m_type)};
 }
@@ -61,11 +69,22 @@ double Token::as_number() const {
     return std::get<double>(m_value);
 }
 
+const std::string& Token::as_identifier() const {
+    const auto type = get_type();
+    if (type != Type::IDENTIFIER) {
+        throw LexerError{"internal: not an identifier: " + token::type_to_int_string(type)};
+    }
+    return std::get<std::string>(m_value);
+}
+
 std::ostream& operator<<(std::ostream& os, const Token& token) {
     switch (token.m_type) {
         case token::Type::NUMBER:
             os << token.as_number();
             break;
+        case token::Type::IDENTIFIER:
+            os << token.as_identifier();
+            break;
         default:
             os << token::type_to_string(token.m_type);
             break;
@@ -8,6 +8,7 @@
 #include "token_type.hpp"
 
 #include <cstddef>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <variant>
@@ -20,6 +21,7 @@ public:
 
     explicit Token(token::Type type);
     explicit Token(double value);
+    explicit Token(const std::string_view& identifier);
 
     bool operator==(const Token& other) const;
     bool operator!=(const Token& other) const { return !(*this == other); }
@@ -27,10 +29,11 @@ public:
     Type get_type() const { return m_type; }
 
     double as_number() const;
+    const std::string& as_identifier() const;
 
 private:
     token::Type m_type;
-    std::variant<double> m_value;
+    std::variant<double, std::string> m_value;
 
     friend std::ostream& operator<<(std::ostream&, const Token&);
 };
@@ -44,6 +47,8 @@ public:
 
     std::size_t get_length() const { return m_view.length(); }
 
+    const std::string_view& get_view() const { return m_view; }
+
 private:
     std::size_t m_pos;
     std::string_view m_view;
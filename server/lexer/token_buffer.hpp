@@ -0,0 +1,99 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "details/classify.hpp"
+#include "token_type.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace math::server::lexer {
+
+// All the tokens of a single input, packed into parallel arrays.
+// Meant to be reused between inputs, so that it stops allocating memory
+// eventually.
+
+class TokenBuffer {
+public:
+    using Type = token::Type;
+    using Offset = std::uint32_t;
+
+    // The lexer rejects longer inputs before adding any tokens.
+    static constexpr std::size_t MAX_INPUT_LENGTH = std::numeric_limits<Offset>::max();
+
+    // A contiguous range of tokens, along with the indices of the first
+    // number and the first identifier in it.
+    struct Range {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::size_t first_number = 0;
+        std::size_t first_identifier = 0;
+    };
+
+    TokenBuffer() = default;
+
+    void clear() {
+        m_types.clear();
+        m_offsets.clear();
+        m_numbers.clear();
+        m_identifiers.clear();
+    }
+
+    std::size_t size() const { return m_types.size(); }
+
+    bool empty() const { return m_types.empty(); }
+
+    Range all() const { return {0, size(), 0, 0}; }
+
+    Type get_type(std::size_t i) const { return static_cast<Type>(m_types[i]); }
+
+    std::size_t get_pos(std::size_t i) const { return m_offsets[i]; }
+
+    // Numbers are stored separately, in the order they appear in the input.
+    // The n-th NUMBER token's value is get_number(n).
+    std::size_t numof_numbers() const { return m_numbers.size(); }
+
+    double get_number(std::size_t n) const { return m_numbers[n]; }
+
+    // Same for identifiers, which point into the input.
+    std::size_t numof_identifiers() const { return m_identifiers.size(); }
+
+    const std::string_view& get_identifier(std::size_t n) const { return m_identifiers[n]; }
+
+    void add(Type type, std::size_t pos) {
+        static_assert(token::type_to_int(token::LAST_TYPE) <=
+                      std::numeric_limits<std::uint8_t>::max());
+        m_types.emplace_back(static_cast<std::uint8_t>(token::type_to_int(type)));
+        m_offsets.emplace_back(static_cast<Offset>(pos));
+    }
+
+    void add_number(double value, std::size_t pos) {
+        add(Type::NUMBER, pos);
+        m_numbers.emplace_back(value);
+    }
+
+    void add_identifier(const std::string_view& name, std::size_t pos) {
+        add(Type::IDENTIFIER, pos);
+        m_identifiers.emplace_back(name);
+    }
+
+    // The lexer classifies the input here, so that it doesn't allocate memory
+    // for every input either.
+    details::CharMap& get_char_map() { return m_char_map; }
+
+private:
+    std::vector<std::uint8_t> m_types;
+    std::vector<Offset> m_offsets;
+    std::vector<double> m_numbers;
+    std::vector<std::string_view> m_identifiers;
+    details::CharMap m_char_map{{}};
+};
+
+} // namespace math::server::lexer
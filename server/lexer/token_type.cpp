@@ -37,11 +37,15 @@ private:
             {Type::LEFT_PAREN, "("},
             {Type::RIGHT_PAREN, ")"},
             {Type::NUMBER, "number"},
+            {Type::IDENTIFIER, "identifier"},
         };
         return map;
     }
 
-    void validate() const { check_for_duplicates(); }
+    void validate() const {
+        check_for_duplicates();
+        check_const_tokens();
+    }
 
     void check_for_duplicates() const {
         std::unordered_set<std::string> strings;
@@ -54,6 +58,18 @@ private:
         }
     }
 
+    void check_const_tokens() const {
+        for (const auto& [type, str] : m_map) {
+            if (!is_const_token(type)) {
+                continue;
+            }
+            if (str != std::string(1, type_to_char(type))) {
+                throw std::logic_error{"type_to_char doesn't match the string representation: " +
+                                       str};
+            }
+        }
+    }
+
     const ToStringMap& m_map;
 };
 
@@ -108,10 +124,6 @@ private:
 
 } // namespace
 
-TypeInt type_to_int(Type type) {
-    return static_cast<TypeInt>(type);
-}
-
 std::string type_to_int_string(Type type) {
     return std::to_string(type_to_int(type));
 }
@@ -120,6 +132,7 @@ bool is_const_token(Type type) {
     switch (type) {
         case Type::WHITESPACE:
         case Type::NUMBER:
+        case Type::IDENTIFIER:
             return false;
         default:
             return true;
@@ -134,6 +147,7 @@ const TypeSet& const_tokens() {
 bool token_has_value(Type type) {
     switch (type) {
         case Type::NUMBER:
+        case Type::IDENTIFIER:
             return true;
         default:
             return false;
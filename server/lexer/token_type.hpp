@@ -22,14 +22,44 @@ enum class Type {
     LEFT_PAREN,
     RIGHT_PAREN,
     NUMBER,
+    IDENTIFIER,
 };
 
+// Must be the last member of the enum above.
+constexpr Type LAST_TYPE = Type::IDENTIFIER;
+
 using TypeInt = std::underlying_type<Type>::type;
 using TypeSet = std::unordered_set<Type>;
 
-TypeInt type_to_int(Type);
+constexpr TypeInt type_to_int(Type type) {
+    return static_cast<TypeInt>(type);
+}
+
 std::string type_to_int_string(Type);
 
+// Every constant token is a single character.
+// This is what the lexer uses; the strings below are for diagnostics only.
+constexpr char type_to_char(Type type) {
+    switch (type) {
+        case Type::PLUS:
+            return '+';
+        case Type::MINUS:
+            return '-';
+        case Type::ASTERISK:
+            return '*';
+        case Type::SLASH:
+            return '/';
+        case Type::CARET:
+            return '^';
+        case Type::LEFT_PAREN:
+            return '(';
+        case Type::RIGHT_PAREN:
+            return ')';
+        default:
+            return '\0';
+    }
+}
+
 bool is_const_token(Type);
 const TypeSet& const_tokens();
 
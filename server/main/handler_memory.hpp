@@ -0,0 +1,126 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace math::server {
+
+// Memory for a session's asynchronous operations.
+// Asio allocates the state of every operation (and of every handler it posts
+// to an executor) using the handler's associated allocator, so that the
+// read -> evaluate -> write cycle doesn't have to allocate any.
+// There are a few fixed-size slots; larger operations (or more of them at
+// once) fall back to the heap.
+// Reads and writes can complete on different threads at the same time, hence
+// the atomics.
+
+class HandlerMemory {
+public:
+    static constexpr std::size_t NUMOF_SLOTS = 8;
+    static constexpr std::size_t SLOT_SIZE = 384;
+
+    HandlerMemory() = default;
+
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(std::size_t size) {
+        if (size <= SLOT_SIZE) {
+            for (auto& slot : m_slots) {
+                if (!slot.m_used.exchange(true, std::memory_order_acquire)) {
+                    return slot.m_storage;
+                }
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void* ptr) {
+        for (auto& slot : m_slots) {
+            if (ptr == slot.m_storage) {
+                slot.m_used.store(false, std::memory_order_release);
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    struct Slot {
+        alignas(std::max_align_t) unsigned char m_storage[SLOT_SIZE];
+        std::atomic<bool> m_used{false};
+    };
+
+    std::array<Slot, NUMOF_SLOTS> m_slots;
+};
+
+template <typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& memory) : m_memory{&memory} {}
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) : m_memory{other.m_memory} {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(m_memory->allocate(sizeof(T) * n)); }
+
+    void deallocate(T* ptr, std::size_t) { m_memory->deallocate(ptr); }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U>& other) const {
+        return m_memory == other.m_memory;
+    }
+
+    template <typename U>
+    bool operator!=(const HandlerAllocator<U>& other) const {
+        return m_memory != other.m_memory;
+    }
+
+private:
+    template <typename>
+    friend class HandlerAllocator;
+
+    HandlerMemory* m_memory;
+};
+
+// A completion handler using the memory.
+// The memory must outlive the operation (a session's handlers keep the
+// session alive).
+template <typename Handler>
+class AllocatingHandler {
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    AllocatingHandler(HandlerMemory& memory, Handler handler)
+        : m_memory{memory}, m_handler{std::move(handler)} {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type{m_memory}; }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        m_handler(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory& m_memory;
+    Handler m_handler;
+};
+
+template <typename Handler>
+AllocatingHandler<std::decay_t<Handler>> make_allocating_handler(HandlerMemory& memory,
+                                                                 Handler&& handler) {
+    return {memory, std::forward<Handler>(handler)};
+}
+
+} // namespace math::server
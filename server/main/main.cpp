@@ -6,6 +6,8 @@
 #include "server.hpp"
 #include "settings.hpp"
 
+#include <common/log.hpp>
+
 #include <boost/program_options.hpp>
 
 #include <exception>
@@ -23,6 +25,7 @@ int main(int argc, char* argv[]) {
             }
 
             math::server::Server server{settings};
+            math::server::log::log("Socket IO: %1%", math::server::Server::get_io_backend());
             server.run();
         } catch (const boost::program_options::error& e) {
             parser.usage_error(e);
@@ -9,53 +9,297 @@
 #include "session_manager.hpp"
 #include "settings.hpp"
 
+#include <cache/reply_cache.hpp>
 #include <common/error.hpp>
 #include <common/log.hpp>
+#include <compute/worker_pool.hpp>
 
 #include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/system/system_error.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <exception>
+#include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace math::server {
 namespace {
 
+// Accepts both TCP and UNIX domain socket connections.
+using Acceptor = boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol>;
+
 boost::asio::ip::tcp::endpoint make_endpoint(unsigned short port) {
     return {boost::asio::ip::tcp::v4(), port};
 }
 
-void configure_acceptor(boost::asio::ip::tcp::acceptor& acceptor, unsigned short port) {
+// A socket option that Asio doesn't define, see the SettableSocketOption
+// requirements.
+// Boolean options are integers too, as far as setsockopt() is concerned.
+template <int Level, int Name>
+class IntegerOption {
+public:
+    explicit IntegerOption(int value) : m_value{value} {}
+
+    template <typename Protocol>
+    int level(const Protocol&) const {
+        return Level;
+    }
+
+    template <typename Protocol>
+    int name(const Protocol&) const {
+        return Name;
+    }
+
+    template <typename Protocol>
+    const int* data(const Protocol&) const {
+        return &m_value;
+    }
+
+    template <typename Protocol>
+    std::size_t size(const Protocol&) const {
+        return sizeof(m_value);
+    }
+
+private:
+    int m_value;
+};
+
+void set_reuse_port(Acceptor& acceptor) {
+#ifdef SO_REUSEPORT
+    acceptor.set_option(IntegerOption<SOL_SOCKET, SO_REUSEPORT>{1});
+#else
+    (void)acceptor;
+    throw Error{"SO_REUSEPORT is not supported"};
+#endif
+}
+
+// Connections are only accepted when the client sends something (or after
+// the timeout, in seconds).
+// Ignored on anything but Linux.
+void set_defer_accept(Acceptor& acceptor, unsigned timeout) {
+#ifdef TCP_DEFER_ACCEPT
+    acceptor.set_option(IntegerOption<IPPROTO_TCP, TCP_DEFER_ACCEPT>{static_cast<int>(timeout)});
+#else
+    (void)acceptor;
+    (void)timeout;
+#endif
+}
+
+void configure_tcp_acceptor(Acceptor& acceptor,
+                            unsigned short port,
+                            bool reuse_port,
+                            unsigned defer_accept) {
+    try {
+        const Acceptor::endpoint_type endpoint{make_endpoint(port)};
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(Acceptor::reuse_address(true));
+        if (reuse_port) {
+            set_reuse_port(acceptor);
+        }
+        if (defer_accept != 0) {
+            set_defer_accept(acceptor, defer_accept);
+        }
+        acceptor.bind(endpoint);
+        acceptor.listen();
+    } catch (const boost::system::system_error& e) {
+        throw Error{e.what()};
+    }
+}
+
+// Anything but a socket is left alone.
+void remove_unix_socket(const std::string& path) {
+    boost::system::error_code ec;
+    if (boost::filesystem::status(path, ec).type() == boost::filesystem::socket_file) {
+        boost::filesystem::remove(path, ec);
+    }
+}
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+// A server that wasn't stopped cleanly leaves the socket file behind, and
+// bind() would fail because of it.
+// The file is only removed if nobody listens on it anymore, which is what
+// ECONNREFUSED means.
+void remove_stale_unix_socket(const std::string& path) {
+    boost::system::error_code ec;
+    if (boost::filesystem::status(path, ec).type() != boost::filesystem::socket_file) {
+        return;
+    }
+    boost::asio::io_context io_context;
+    boost::asio::local::stream_protocol::socket socket{io_context};
+    socket.connect(boost::asio::local::stream_protocol::endpoint{path}, ec);
+    if (!ec) {
+        throw Error{"address already in use: " + path};
+    }
+    if (ec != boost::asio::error::connection_refused) {
+        throw Error{"couldn't connect to " + path + ": " + ec.message()};
+    }
+    remove_unix_socket(path);
+}
+#endif
+
+void configure_unix_acceptor(Acceptor& acceptor, const std::string& path) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
     try {
-        const auto endpoint = make_endpoint(port);
+        remove_stale_unix_socket(path);
+        const Acceptor::endpoint_type endpoint{boost::asio::local::stream_protocol::endpoint{path}};
         acceptor.open(endpoint.protocol());
-        acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
         acceptor.bind(endpoint);
         acceptor.listen();
     } catch (const boost::system::system_error& e) {
         throw Error{e.what()};
     }
+#else
+    (void)acceptor;
+    (void)path;
+    throw Error{"UNIX domain sockets are not supported"};
+#endif
+}
+
+int concurrency_hint(bool per_core) {
+    if (per_core) {
+        // Lets Asio skip some of the locking.
+        return 1;
+    }
+    return BOOST_ASIO_CONCURRENCY_HINT_DEFAULT;
+}
+
+boost::asio::executor make_executor(boost::asio::io_context& io_context, bool per_core) {
+    if (per_core) {
+        return io_context.get_executor();
+    }
+    return boost::asio::io_context::strand{io_context};
+}
+
+// Pins the i-th IO thread to the i-th CPU it's allowed to run on.
+void pin_thread(std::size_t i) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        log::error("%1%: %2%", __func__, std::strerror(errno));
+        return;
+    }
+    auto n = i % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed) || n-- != 0) {
+            continue;
+        }
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        const auto ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (ret != 0) {
+            log::error("%1%: %2%", __func__, std::strerror(ret));
+        }
+        return;
+    }
+#else
+    (void)i;
+    log::error("%1%: not supported on this platform", __func__);
+#endif
+}
+
+std::unique_ptr<ReplyCache> make_cache(std::size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    return std::make_unique<ReplyCache>(size);
+}
+
+std::unique_ptr<WorkerPool> make_pool(std::size_t threads,
+                                      std::size_t parallel_threshold,
+                                      std::size_t offload_threshold) {
+    if (threads == 0 || (parallel_threshold == 0 && offload_threshold == 0)) {
+        return nullptr;
+    }
+    return std::make_unique<WorkerPool>(threads);
+}
+
+void log_cache_stats(const ReplyCache& cache) {
+    const auto stats = cache.get_stats();
+    log::log("Cache: %1% hit(s), %2% miss(es), %3% insertion(s), %4% rejection(s), "
+             "%5% eviction(s), %6% entries using %7% bytes",
+             stats.hits, stats.misses, stats.insertions, stats.rejections, stats.evictions,
+             stats.entries, stats.bytes);
 }
 
 } // namespace
 
-Server::Server(const Settings& settings) : Server{settings.m_port, settings.m_threads} {}
+Server::Server(const Settings& settings)
+    : m_numof_threads{settings.m_threads},
+      m_pin_threads{settings.m_pin_threads},
+      m_port{settings.m_port},
+      m_cache{make_cache(settings.m_cache_size)},
+      m_pool{make_pool(settings.m_compute_threads,
+                       settings.m_parallel_threshold,
+                       settings.m_offload_threshold)} {
+    const auto per_core = settings.m_per_core;
+    const SessionContext context{settings.m_precision,
+                                 settings.m_max_depth,
+                                 settings.m_max_line_length,
+                                 m_cache.get(),
+                                 &m_expressions,
+                                 m_pool.get(),
+                                 settings.m_parallel_threshold,
+                                 settings.m_offload_threshold,
+                                 settings.m_jit_threshold,
+                                 per_core};
+
+    const auto numof_shards = per_core ? std::max<std::size_t>(m_numof_threads, 1) : 1;
+    const auto threads_per_shard = per_core ? 1 : m_numof_threads;
+    for (std::size_t i = 0; i < numof_shards; ++i) {
+        // SO_REUSEPORT doesn't work for UNIX domain sockets, so only the first
+        // shard listens on one.
+        const auto& shard_unix_socket = i == 0 ? settings.m_unix_socket : std::string{};
+        m_shards.emplace_back(std::make_unique<Shard>(m_port, shard_unix_socket, context,
+                                                      threads_per_shard, per_core,
+                                                      settings.m_defer_accept));
+        // If the OS chose the port, the other shards must use the same one.
+        m_port = m_shards.front()->get_port();
+    }
 
-Server::Server(unsigned short port, std::size_t threads)
-    : m_numof_threads{threads}, m_signals{m_io_context}, m_acceptor{m_io_context} {
     wait_for_signal();
-    configure_acceptor(m_acceptor, port);
+}
 
-    accept();
+const char* Server::get_io_backend() {
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_IOCP)
+    return "IOCP";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+    return "kqueue";
+#elif defined(BOOST_ASIO_HAS_DEV_POLL)
+    return "/dev/poll";
+#else
+    return "select";
+#endif
 }
 
 void Server::run() {
     std::vector<std::thread> threads{m_numof_threads};
     for (std::size_t i = 0; i < m_numof_threads; ++i) {
-        threads[i] = std::thread{[this]() { m_io_context.run(); }};
+        auto& shard = *m_shards[i % m_shards.size()];
+        threads[i] = std::thread{[this, i, &shard]() {
+            if (m_pin_threads) {
+                pin_thread(i);
+            }
+            shard.run();
+        }};
     }
 
     for (std::size_t i = 0; i < m_numof_threads; ++i) {
@@ -65,10 +309,11 @@ void Server::run() {
 
 void Server::wait_for_signal() {
     try {
-        m_signals.add(SIGINT);
-        m_signals.add(SIGTERM);
+        m_signals = std::make_unique<boost::asio::signal_set>(m_shards.front()->io_context());
+        m_signals->add(SIGINT);
+        m_signals->add(SIGTERM);
 
-        m_signals.async_wait(
+        m_signals->async_wait(
             [this](const boost::system::error_code& ec, int signo) { handle_signal(ec, signo); });
     } catch (const boost::system::system_error& e) {
         throw Error{e.what()};
@@ -76,35 +321,135 @@ void Server::wait_for_signal() {
 }
 
 void Server::handle_signal(const boost::system::error_code& ec, int signo) {
+    if (ec == boost::asio::error::operation_aborted) {
+        // See stop().
+        return;
+    }
     if (ec) {
         log::error("%1%: %2%", __func__, ec.message());
     }
 
     log::log("Caught signal %1%", signo);
+    stop();
+}
 
+void Server::stop() {
+    // Otherwise, run() would keep waiting for a signal.
+    boost::asio::post(m_shards.front()->io_context(), [this]() { m_signals->cancel(); });
+    for (const auto& shard : m_shards) {
+        shard->stop();
+    }
+    if (m_cache) {
+        log_cache_stats(*m_cache);
+    }
+}
+
+Server::Shard::Shard(unsigned short port,
+                     const std::string& unix_socket,
+                     const SessionContext& context,
+                     std::size_t numof_threads,
+                     bool per_core,
+                     unsigned defer_accept)
+    : m_io_context{concurrency_hint(per_core)},
+      m_executor{make_executor(m_io_context, per_core)},
+      m_unix_socket{unix_socket},
+      m_session_mgr{context} {
+    m_acceptors.emplace_back(std::make_unique<Acceptor>(m_io_context));
+    configure_tcp_acceptor(*m_acceptors.back(), port, per_core, defer_accept);
+    if (!m_unix_socket.empty()) {
+        m_acceptors.emplace_back(std::make_unique<Acceptor>(m_io_context));
+        configure_unix_acceptor(*m_acceptors.back(), m_unix_socket);
+    }
+
+    const auto numof_accepts = ACCEPTS_PER_THREAD * std::max<std::size_t>(numof_threads, 1);
+    for (const auto& acceptor : m_acceptors) {
+        for (std::size_t i = 0; i < numof_accepts; ++i) {
+            m_accepts.emplace_back(std::make_unique<PendingAccept>(m_io_context, *acceptor));
+            accept(*m_accepts.back());
+        }
+    }
+}
+
+unsigned short Server::Shard::get_port() const {
+    // The first acceptor is always the TCP one.
+    const auto generic = m_acceptors.front()->local_endpoint();
+    boost::asio::ip::tcp::endpoint endpoint;
+    std::memcpy(endpoint.data(), generic.data(), generic.size());
+    endpoint.resize(generic.size());
+    return endpoint.port();
+}
+
+void Server::Shard::run() {
+    m_io_context.run();
+}
+
+void Server::Shard::stop() {
+    boost::asio::post(m_executor, [this]() { close(); });
+}
+
+void Server::Shard::close() {
     try {
-        m_acceptor.close();
+        for (const auto& acceptor : m_acceptors) {
+            acceptor->close();
+        }
+        if (!m_unix_socket.empty()) {
+            remove_unix_socket(m_unix_socket);
+        }
+        for (const auto& pending : m_accepts) {
+            pending->m_timer.cancel();
+        }
         m_session_mgr.stop_all();
     } catch (const std::exception& e) {
         log::error(e.what());
     }
 }
 
-void Server::accept() {
+void Server::Shard::accept(PendingAccept& pending) {
     const auto session = m_session_mgr.make_session(m_io_context);
-    m_acceptor.async_accept(
+    pending.m_acceptor.async_accept(
         session->socket(),
-        [session, this](const boost::system::error_code& ec) { handle_accept(session, ec); });
+        boost::asio::bind_executor(m_executor, [this, &pending, session](
+                                                   const boost::system::error_code& ec) {
+            handle_accept(pending, session, ec);
+        }));
 }
 
-void Server::handle_accept(SessionPtr session, const boost::system::error_code& ec) {
+void Server::Shard::handle_accept(PendingAccept& pending,
+                                  SessionPtr session,
+                                  const boost::system::error_code& ec) {
+    if (!pending.m_acceptor.is_open()) {
+        // The server is stopping.
+        return;
+    }
     if (ec) {
-        log::error("%1%: %2%", __func__, ec.message());
+        retry(pending, ec);
         return;
     }
 
+    pending.m_backoff = {};
+    accept(pending);
     m_session_mgr.start(session);
-    accept();
+}
+
+void Server::Shard::retry(PendingAccept& pending, const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::connection_aborted) {
+        // The client gave up before the connection was accepted.
+        accept(pending);
+        return;
+    }
+
+    // Most likely, there are too many open files, and accepting again
+    // straight away would just spin.
+    pending.m_backoff = std::clamp(2 * pending.m_backoff, MIN_BACKOFF, MAX_BACKOFF);
+    log::error("%1%: %2% (retrying in %3% ms)", __func__, ec.message(), pending.m_backoff.count());
+    pending.m_timer.expires_after(pending.m_backoff);
+    pending.m_timer.async_wait(boost::asio::bind_executor(
+        m_executor, [this, &pending](const boost::system::error_code& ec) {
+            if (ec || !pending.m_acceptor.is_open()) {
+                return;
+            }
+            accept(pending);
+        }));
 }
 
 } // namespace math::server
@@ -5,37 +5,126 @@
 
 #pragma once
 
+#include "session_context.hpp"
 #include "session_manager.hpp"
 #include "settings.hpp"
 
+#include <cache/reply_cache.hpp>
+#include <command/registry.hpp>
+#include <compute/worker_pool.hpp>
+
 #include <boost/asio.hpp>
 #include <boost/system/error_code.hpp>
 
+#include <chrono>
 #include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace math::server {
 
 class Server {
 public:
-    Server(const Settings& settings);
-    Server(unsigned short port, std::size_t threads);
+    explicit Server(const Settings& settings);
+
+    // What Asio does the socket IO with.
+    // It's chosen at build time (see the IO_URING CMake option), not by the
+    // settings.
+    static const char* get_io_backend();
+
+    // The TCP port the server listens on (the one chosen by the OS if the
+    // settings specify port 0).
+    unsigned short get_port() const { return m_port; }
 
     void run();
+    // Stops accepting connections and closes the existing ones, after which
+    // run() returns.
+    // Also done on SIGINT and SIGTERM.
+    void stop();
 
 private:
+    // An io_context with its own acceptors and sessions.
+    // Normally, there's a single one, run by every IO thread.
+    // In per-core mode, every IO thread runs its own, and the kernel spreads
+    // the connections between the acceptors (see SO_REUSEPORT).
+    // There are a few accepts in flight per thread (and acceptor), so that a
+    // burst of connections is accepted by every thread at once.
+    // Besides TCP, a shard might also listen on a UNIX domain socket; both
+    // kinds of connections are served by the same sessions.
+    class Shard {
+    public:
+        static constexpr std::size_t ACCEPTS_PER_THREAD = 4;
+
+        // No UNIX domain socket if the path is empty.
+        Shard(unsigned short port,
+              const std::string& unix_socket,
+              const SessionContext&,
+              std::size_t numof_threads,
+              bool per_core,
+              unsigned defer_accept);
+
+        boost::asio::io_context& io_context() { return m_io_context; }
+
+        unsigned short get_port() const;
+
+        void run();
+        // Can be called from any thread.
+        void stop();
+
+    private:
+        using Acceptor = boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol>;
+        using AcceptorPtr = std::unique_ptr<Acceptor>;
+
+        // Either waits for a connection, or for the time to retry after an
+        // error (e.g. too many open files).
+        struct PendingAccept {
+            PendingAccept(boost::asio::io_context& io_context, Acceptor& acceptor)
+                : m_acceptor{acceptor}, m_timer{io_context} {}
+
+            Acceptor& m_acceptor;
+            boost::asio::steady_timer m_timer;
+            std::chrono::milliseconds m_backoff{0};
+        };
+
+        static constexpr std::chrono::milliseconds MIN_BACKOFF{10};
+        static constexpr std::chrono::milliseconds MAX_BACKOFF{1000};
+
+        void accept(PendingAccept&);
+        void handle_accept(PendingAccept&,
+                           SessionPtr session,
+                           const boost::system::error_code& ec);
+        void retry(PendingAccept&, const boost::system::error_code& ec);
+        void close();
+
+        boost::asio::io_context m_io_context;
+        // The acceptors are only used on this, since they're not thread-safe.
+        // It's a strand, unless the io_context is run by a single thread.
+        boost::asio::executor m_executor;
+        std::vector<AcceptorPtr> m_acceptors;
+        // Removed when the shard is stopped.
+        const std::string m_unix_socket;
+        std::vector<std::unique_ptr<PendingAccept>> m_accepts;
+        SessionManager m_session_mgr;
+    };
+
+    using ShardPtr = std::unique_ptr<Shard>;
+
     void wait_for_signal();
     void handle_signal(const boost::system::error_code&, int);
 
-    void accept();
-    void handle_accept(SessionPtr session, const boost::system::error_code& ec);
-
     const std::size_t m_numof_threads;
+    const bool m_pin_threads;
+    unsigned short m_port;
 
-    boost::asio::io_context m_io_context;
-    boost::asio::signal_set m_signals;
-    boost::asio::ip::tcp::acceptor m_acceptor;
-
-    SessionManager m_session_mgr;
+    std::unique_ptr<ReplyCache> m_cache;
+    ExpressionRegistry m_expressions;
+    std::vector<ShardPtr> m_shards;
+    // Stopped before the shards are destroyed, since the workers post the
+    // replies to them.
+    std::unique_ptr<WorkerPool> m_pool;
+    // Handled by the first shard.
+    std::unique_ptr<boost::asio::signal_set> m_signals;
 };
 
 } // namespace math::server
@@ -7,115 +7,661 @@
 
 #include "session_manager.hpp"
 
+#include <cache/reply_cache.hpp>
+#include <command/error.hpp>
+#include <command/processor.hpp>
+#include <common/binary_protocol.hpp>
 #include <common/error.hpp>
+#include <common/format.hpp>
 #include <common/log.hpp>
-#include <parser/parser.hpp>
+#include <common/result.hpp>
+#include <compute/parallel_parser.hpp>
+#include <parser/error.hpp>
+#include <parser/stream_parser.hpp>
 
 #include <boost/asio.hpp>
-#include <boost/lexical_cast.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/system/system_error.hpp>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <variant>
 
 namespace math::server {
 namespace {
 
-std::string reply_to_string(double result) {
-    return boost::lexical_cast<std::string>(result);
+// Include CR (so that Windows' telnet client works)
+constexpr std::string_view REPLY_TERMINATOR{"\r\n"};
+constexpr std::string_view PREPARED_REPLY{"ok"};
+// A line (or a binary request) can hold a batch of expressions, which are
+// replied to all at once.
+constexpr char BATCH_SEPARATOR = ';';
+constexpr std::string_view REPLY_SEPARATOR{"; "};
+
+// Buffers larger than this are freed when a session is reset.
+constexpr std::size_t MAX_REUSED_CAPACITY = 64 * 1024;
+
+void clear_buffer(std::string& buffer) {
+    if (buffer.capacity() > MAX_REUSED_CAPACITY) {
+        std::string{}.swap(buffer);
+    } else {
+        buffer.clear();
+    }
 }
 
-std::string calc_reply(const std::string& input) {
-    std::string reply;
-    try {
-        reply = reply_to_string(Parser{input}.exec());
-    } catch (const std::exception& e) {
-        reply = e.what();
+template <typename Process>
+void for_each_item(const std::string_view& input, Process&& process) {
+    std::size_t pos = 0;
+    for (auto sep = input.find(BATCH_SEPARATOR); sep != std::string_view::npos;
+         sep = input.find(BATCH_SEPARATOR, pos)) {
+        process(input.substr(pos, sep - pos));
+        pos = sep + 1;
     }
-    return reply;
+    process(input.substr(pos));
+}
+
+// Errors might quote the rest of the input, whitespace and all, in which case
+// the reply can't be shared between inputs with the same normalized form.
+bool is_cacheable(const std::string_view& input, const Result<double>& result) {
+    if (result) {
+        return true;
+    }
+    const auto& context = result.error().get_context();
+    return context.empty() || context.data() + context.length() != input.data() + input.length();
 }
 
 } // namespace
 
-Session::Session(SessionManager& mgr, boost::asio::io_context& io_context)
-    : m_session_mgr{mgr}, m_strand{io_context}, m_socket{io_context} {}
+std::variant<Session::Executor, Session::Strand> Session::make_executor(
+    boost::asio::io_context& io_context,
+    const SessionContext& context,
+    HandlerMemory& memory) {
+    // The functions the executor has to queue come from the session's memory
+    // too.
+    const HandlerAllocator<void> allocator{memory};
+    const auto executor = boost::asio::require(io_context.get_executor(),
+                                               boost::asio::execution::allocator(allocator));
+    if (context.m_single_threaded) {
+        return executor;
+    }
+    return Strand{executor};
+}
+
+Session::Session(SessionManager& mgr,
+                 boost::asio::io_context& io_context,
+                 const SessionContext& context)
+    : m_session_mgr{mgr},
+      m_context{context},
+      m_executor{make_executor(io_context, context, m_handler_memory)},
+      m_socket{io_context},
+      m_input{context.m_max_line_length},
+      m_parser{context.m_pool, context.m_parallel_threshold, context.m_max_depth},
+      m_stream{context.m_max_depth},
+      m_commands{context.m_expressions, context.m_max_depth, context.m_jit_threshold} {}
 
-boost::asio::ip::tcp::socket& Session::socket() {
+Session::Socket& Session::socket() {
     return m_socket;
 }
 
 void Session::start() {
-    read();
+    read_chunk();
 }
 
 void Session::stop() {
+    m_stopped = true;
     close();
 }
 
+void Session::reset() {
+    boost::system::error_code ec;
+    m_socket.close(ec);
+
+    m_protocol = Protocol::UNKNOWN;
+    m_input.consume(m_input.size());
+    clear_buffer(m_output);
+    clear_buffer(m_sending);
+    m_writing = false;
+    m_read_paused = false;
+    m_input_closed = false;
+    m_skipping_line = false;
+    m_eof = false;
+    m_stopped = false;
+    m_cache_key.clear();
+    clear_buffer(m_offloaded_input);
+    m_offloaded_id = 0;
+    m_stream.reset();
+    m_commands.reset();
+}
+
+bool Session::is_reusable() const {
+    // The buffer grows geometrically, so it might overshoot the limit.
+    return m_input.capacity() <= 2 * SessionContext::DEFAULT_MAX_LINE_LENGTH;
+}
+
 void Session::close() {
+    // Fails if the client has reset the connection already.
+    boost::system::error_code ec;
+    m_socket.shutdown(Socket::shutdown_both, ec);
     try {
-        m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both);
         m_socket.close();
     } catch (const boost::system::system_error& e) {
         throw Error{e.what()};
     }
 }
 
+template <typename Operation, typename Handler>
+void Session::initiate(Operation&& operation, Handler&& handler) {
+    std::visit(
+        [&](const auto& executor) {
+            operation(boost::asio::bind_executor(
+                executor,
+                make_allocating_handler(m_handler_memory, std::forward<Handler>(handler))));
+        },
+        m_executor);
+}
+
+template <typename Function>
+void Session::post(Function&& function) {
+    std::visit(
+        [&](const auto& executor) {
+            boost::asio::post(executor, make_allocating_handler(
+                                            m_handler_memory, std::forward<Function>(function)));
+        },
+        m_executor);
+}
+
 void Session::read() {
+    if (m_input_closed) {
+        // Every line has been replied to.
+        stop_after_write();
+        return;
+    }
+    if (m_protocol == Protocol::BINARY) {
+        read_chunk();
+        return;
+    }
+
     const auto self = shared_from_this();
 
     // Stop at LF
-    boost::asio::async_read_until(
-        m_socket, m_buffer, '\n',
-        boost::asio::bind_executor(
-            m_strand, [this, self](const boost::system::error_code& ec, std::size_t bytes) {
-                handle_read(ec, bytes);
-            }));
+    initiate(
+        [this](auto&& handler) {
+            boost::asio::async_read_until(m_socket, m_input, '\n', std::move(handler));
+        },
+        [this, self](const boost::system::error_code& ec, std::size_t bytes) {
+            handle_read(ec, bytes);
+        });
+}
+
+void Session::read_chunk() {
+    const auto self = shared_from_this();
+
+    initiate(
+        [this](auto&& handler) {
+            m_socket.async_read_some(
+                m_input.prepare(std::min(STREAM_CHUNK_SIZE, m_input.max_size() - m_input.size())),
+                std::move(handler));
+        },
+        [this, self](const boost::system::error_code& ec, std::size_t bytes) {
+            handle_read_chunk(ec, bytes);
+        });
+}
+
+void Session::handle_read(const boost::system::error_code& ec, std::size_t) {
+    if (m_stopped) {
+        return;
+    }
+    if (ec == boost::asio::error::not_found) {
+        // The buffer is full, and there's still no LF.
+        stream_line();
+        return;
+    }
+    if (ec == boost::asio::error::eof) {
+        m_input_closed = true;
+        if (m_input.size() == 0) {
+            stop_after_write();
+            return;
+        }
+        terminate_last_line();
+    } else if (ec) {
+        log::error("%1%: %2%", __func__, ec.message());
+        m_session_mgr.stop(shared_from_this());
+        return;
+    }
+
+    process_input();
 }
 
-void Session::handle_read(const boost::system::error_code& ec, std::size_t bytes) {
+void Session::handle_read_chunk(const boost::system::error_code& ec, std::size_t bytes) {
+    if (m_stopped) {
+        return;
+    }
+    if (ec == boost::asio::error::eof) {
+        m_input_closed = true;
+        if (m_protocol == Protocol::TEXT) {
+            // In the middle of a long line.
+            terminate_last_line();
+            stream_input();
+            return;
+        }
+        stop_after_write();
+        return;
+    }
     if (ec) {
         log::error("%1%: %2%", __func__, ec.message());
         m_session_mgr.stop(shared_from_this());
         return;
     }
 
-    write(calc_reply(consume_input(bytes)));
+    m_input.commit(bytes);
+    switch (m_protocol) {
+        case Protocol::UNKNOWN:
+            detect_protocol();
+            return;
+        case Protocol::TEXT:
+            stream_input();
+            return;
+        case Protocol::BINARY:
+            process_requests();
+            return;
+    }
+}
+
+void Session::stop_after_write() {
+    // An incomplete binary request is ignored.
+    if (m_writing) {
+        m_eof = true;
+        return;
+    }
+    m_session_mgr.stop(shared_from_this());
+}
+
+void Session::terminate_last_line() {
+    // There's always room for it, otherwise the read would've failed with
+    // not_found.
+    static constexpr char EOL = '\n';
+    m_input.commit(boost::asio::buffer_copy(m_input.prepare(1), boost::asio::buffer(&EOL, 1)));
+}
+
+void Session::detect_protocol() {
+    const auto first = *boost::asio::buffer_cast<const unsigned char*>(m_input.data());
+    if (first == binary::MAGIC) {
+        m_protocol = Protocol::BINARY;
+        m_input.consume(1);
+        process_requests();
+        return;
+    }
+    m_protocol = Protocol::TEXT;
+    process_input();
 }
 
-std::string Session::consume_input(std::size_t bytes) {
-    const auto data = boost::asio::buffer_cast<const char*>(m_buffer.data());
-    const std::string input{data, bytes - 1};
-    m_buffer.consume(bytes);
-    return input;
+void Session::process_input() {
+    const auto data = boost::asio::buffer_cast<const char*>(m_input.data());
+    const std::string_view input{data, m_input.size()};
+
+    // Pipelined lines are all replied to at once.
+    std::size_t pos = 0;
+    for (auto eol = input.find('\n'); eol != std::string_view::npos;
+         eol = input.find('\n', pos)) {
+        const auto line = input.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (!can_offload(line)) {
+            write_reply(line);
+            continue;
+        }
+        if (write_cached_reply(line)) {
+            write_output(REPLY_TERMINATOR);
+            continue;
+        }
+        offload(line);
+        m_input.consume(pos);
+        return;
+    }
+    m_input.consume(pos);
+    write_and_read();
 }
 
-void Session::write(const std::string& output) {
+void Session::process_requests() {
+    const auto data = boost::asio::buffer_cast<const char*>(m_input.data());
+    const std::string_view input{data, m_input.size()};
+
+    std::size_t pos = 0;
+    while (input.length() - pos >= binary::REQUEST_HEADER_SIZE) {
+        const auto header = binary::decode_header(input.data() + pos);
+        // Binary requests are always buffered in full.
+        if (header.m_length > m_input.max_size() - binary::REQUEST_HEADER_SIZE) {
+            // There's no way to skip the request without reading it.
+            binary::encode_u32(m_output, header.m_id);
+            binary::encode_error(m_output, Error{"request is too long"}.what());
+            m_input.consume(input.length());
+            write();
+            stop_after_write();
+            return;
+        }
+        const auto end = pos + binary::REQUEST_HEADER_SIZE + header.m_length;
+        if (end > input.length()) {
+            break;
+        }
+        const auto request = input.substr(end - header.m_length, header.m_length);
+        pos = end;
+        if (can_offload(request)) {
+            m_offloaded_id = header.m_id;
+            offload(request);
+            m_input.consume(pos);
+            return;
+        }
+        write_binary_reply(header.m_id, request);
+    }
+    m_input.consume(pos);
+    write_and_read();
+}
+
+void Session::stream_line() {
+    const auto data = boost::asio::buffer_cast<const char*>(m_input.data());
+    const std::string_view input{data, m_input.size()};
+
+    // A line starting with a name is either a command, which has to be
+    // buffered in full, or junk the parser would reject at the first token.
+    // Either way, the rest of it isn't even looked at (Parser would report an
+    // invalid byte further on instead of the name, but that's rare).
+    if (!CommandProcessor::get_name(input).empty()) {
+        write_output(command::to_string(CommandProcessor::reject_long_line(input)));
+        write_output(REPLY_TERMINATOR);
+        m_skipping_line = true;
+    } else {
+        m_stream.reset();
+    }
+    stream_input();
+}
+
+void Session::stream_input() {
+    const auto data = boost::asio::buffer_cast<const char*>(m_input.data());
+    const std::string_view input{data, m_input.size()};
+    const auto eol = input.find('\n');
+
+    try {
+        if (eol == std::string_view::npos) {
+            if (!m_skipping_line) {
+                m_stream.feed(input);
+            }
+            m_input.consume(input.length());
+            read_chunk();
+            return;
+        }
+
+        if (m_skipping_line) {
+            m_skipping_line = false;
+            m_input.consume(eol + 1);
+        } else {
+            m_stream.feed(input.substr(0, eol));
+            m_input.consume(eol + 1);
+            write_result(m_stream.finish());
+            write_output(REPLY_TERMINATOR);
+        }
+    } catch (const std::exception& e) {
+        log::error("%1%: %2%", __func__, e.what());
+        m_session_mgr.stop(shared_from_this());
+        return;
+    }
+    process_input();
+}
+
+bool Session::can_offload(const std::string_view& input) const {
+    if (m_context.m_pool == nullptr || m_context.m_offload_threshold == 0) {
+        return false;
+    }
+    if (input.length() < m_context.m_offload_threshold) {
+        return false;
+    }
+    // Replies to these are formatted as they're evaluated.
+    return !CommandProcessor::is_command(input) &&
+           input.find(BATCH_SEPARATOR) == std::string_view::npos;
+}
+
+void Session::offload(const std::string_view& input) {
+    m_offloaded_input.assign(input.data(), input.length());
+    // The replies so far don't have to wait for this one.
+    write();
+
     const auto self = shared_from_this();
 
-    std::ostream os(&m_buffer);
-    // Include CR (so that Windows' telnet client works)
-    os << output << "\r\n";
+    // The reference is handed back to the IO thread, so that the session is
+    // never recycled on the pool (see SessionManager).
+    m_context.m_pool->post([this, self]() mutable {
+        try {
+            const auto result = m_parser.try_exec(m_offloaded_input);
+            post([this, self = std::move(self), result]() { handle_offloaded(result); });
+        } catch (const std::exception& e) {
+            post([this, self = std::move(self), msg = std::string{e.what()}]() {
+                handle_offload_error(msg);
+            });
+        }
+    });
+}
+
+void Session::handle_offloaded(const Result<double>& result) {
+    if (m_stopped) {
+        // The reply has nowhere to go.
+        return;
+    }
+    if (m_protocol == Protocol::BINARY) {
+        binary::encode_u32(m_output, m_offloaded_id);
+        write_binary_result(result);
+        process_requests();
+        return;
+    }
+    const auto offset = m_output.size();
+    write_result(result);
+    cache_reply(m_offloaded_input, result, offset);
+    write_output(REPLY_TERMINATOR);
+    process_input();
+}
+
+void Session::handle_offload_error(const std::string& msg) {
+    if (m_stopped) {
+        return;
+    }
+    if (m_protocol == Protocol::BINARY) {
+        binary::encode_u32(m_output, m_offloaded_id);
+        binary::encode_error(m_output, msg);
+        process_requests();
+        return;
+    }
+    write_output(msg);
+    write_output(REPLY_TERMINATOR);
+    process_input();
+}
 
-    boost::asio::async_write(
-        m_socket, m_buffer,
-        boost::asio::bind_executor(
-            m_strand, [this, self](const boost::system::error_code& ec, std::size_t bytes) {
-                handle_write(ec, bytes);
-            }));
+void Session::write_reply(const std::string_view& input) {
+    // One bad item doesn't fail the rest of the batch.
+    bool first = true;
+    for_each_item(input, [this, &first](const std::string_view& item) {
+        if (!first) {
+            write_output(REPLY_SEPARATOR);
+        }
+        first = false;
+        write_item_reply(item);
+    });
+    write_output(REPLY_TERMINATOR);
+}
+
+void Session::write_item_reply(const std::string_view& input) {
+    if (CommandProcessor::is_command(input)) {
+        // Replies to commands depend on the session, so they're never cached.
+        write_command_reply(input);
+        return;
+    }
+
+    if (write_cached_reply(input)) {
+        return;
+    }
+
+    try {
+        const auto offset = m_output.size();
+        // Invalid input is not exceptional, so it doesn't throw.
+        const auto result = m_parser.try_exec(input);
+        write_result(result);
+        cache_reply(input, result, offset);
+    } catch (const std::exception& e) {
+        write_output(e.what());
+    }
+}
+
+bool Session::write_cached_reply(const std::string_view& input) {
+    const auto cache = m_context.m_cache;
+    if (cache == nullptr) {
+        return false;
+    }
+    // The key is kept for cache_reply.
+    ReplyCache::normalize(input, m_cache_key);
+    return cache->find(m_cache_key,
+                       [this](const std::string_view& reply) { write_output(reply); });
+}
+
+// The reply is what's been written since the offset.
+void Session::cache_reply(const std::string_view& input,
+                          const Result<double>& result,
+                          std::size_t offset) {
+    const auto cache = m_context.m_cache;
+    if (cache != nullptr && is_cacheable(input, result)) {
+        cache->insert(m_cache_key, std::string_view{m_output}.substr(offset));
+    }
+}
+
+void Session::write_command_reply(const std::string_view& input) {
+    try {
+        const auto result = m_commands.exec(input);
+        if (!result) {
+            write_output(command::to_string(result.error()));
+        } else if (result->has_value()) {
+            write_output(**result);
+        } else {
+            write_output(PREPARED_REPLY);
+        }
+    } catch (const std::exception& e) {
+        write_output(e.what());
+    }
+}
+
+void Session::write_binary_reply(std::uint32_t id, const std::string_view& input) {
+    binary::encode_u32(m_output, id);
+    const auto numof_separators = std::count(input.begin(), input.end(), BATCH_SEPARATOR);
+    if (numof_separators == 0) {
+        write_binary_item(input);
+        return;
+    }
+    binary::encode_batch(m_output, static_cast<std::uint32_t>(numof_separators + 1));
+    for_each_item(input, [this](const std::string_view& item) { write_binary_item(item); });
+}
+
+void Session::write_binary_item(const std::string_view& input) {
+    // The cache holds formatted replies, so it's only used in text mode.
+    try {
+        if (CommandProcessor::is_command(input)) {
+            const auto result = m_commands.exec(input);
+            if (!result) {
+                binary::encode_error(m_output, command::to_string(result.error()));
+            } else if (result->has_value()) {
+                binary::encode_result(m_output, **result);
+            } else {
+                binary::encode_ok(m_output);
+            }
+            return;
+        }
+
+        write_binary_result(m_parser.try_exec(input));
+    } catch (const std::exception& e) {
+        binary::encode_error(m_output, e.what());
+    }
+}
+
+void Session::write_binary_result(const Result<double>& result) {
+    if (result) {
+        binary::encode_result(m_output, *result);
+    } else {
+        binary::encode_error(m_output, parser::to_string(result.error()));
+    }
+}
+
+void Session::write_result(const Result<double>& result) {
+    if (result) {
+        write_output(*result);
+    } else {
+        write_output(parser::to_string(result.error()));
+    }
+}
+
+void Session::write_output(const std::string_view& output) {
+    m_output.append(output);
+}
+
+void Session::write_output(double result) {
+    const auto offset = m_output.size();
+    m_output.resize(offset + format::MAX_NUMBER_LENGTH);
+    const auto first = &m_output[offset];
+    const auto last =
+        format::number(first, first + format::MAX_NUMBER_LENGTH, result, m_context.m_precision);
+    m_output.resize(offset + (last - first));
+}
+
+void Session::write() {
+    if (m_writing || m_output.empty()) {
+        return;
+    }
+    // Both strings keep their capacity, so this doesn't allocate memory in
+    // the long run.
+    m_sending.swap(m_output);
+    m_output.clear();
+    m_writing = true;
+
+    const auto self = shared_from_this();
+
+    initiate(
+        [this](auto&& handler) {
+            boost::asio::async_write(m_socket, boost::asio::buffer(m_sending), std::move(handler));
+        },
+        [this, self](const boost::system::error_code& ec, std::size_t bytes) {
+            handle_write(ec, bytes);
+        });
+}
+
+void Session::write_and_read() {
+    write();
+    if (m_output.size() >= MAX_PENDING_OUTPUT) {
+        // The client isn't reading the replies fast enough.
+        m_read_paused = true;
+        return;
+    }
+    read();
 }
 
 void Session::handle_write(const boost::system::error_code& ec, std::size_t) {
+    m_writing = false;
+    if (m_stopped) {
+        return;
+    }
     if (ec) {
         log::error("%1%: %2%", __func__, ec.message());
         m_session_mgr.stop(shared_from_this());
         return;
     }
 
-    read();
+    // Replies to the input that arrived in the meantime.
+    write();
+    if (m_eof && !m_writing) {
+        m_session_mgr.stop(shared_from_this());
+        return;
+    }
+    if (m_read_paused && m_output.size() < MAX_PENDING_OUTPUT) {
+        m_read_paused = false;
+        read();
+    }
 }
 
 } // namespace math::server
@@ -5,12 +5,25 @@
 
 #pragma once
 
+#include "handler_memory.hpp"
+#include "session_context.hpp"
+
+#include <command/processor.hpp>
+#include <common/binary_protocol.hpp>
+#include <common/result.hpp>
+#include <compute/parallel_parser.hpp>
+#include <parser/stream_parser.hpp>
+
 #include <boost/asio.hpp>
 #include <boost/system/error_code.hpp>
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <variant>
 
 namespace math::server {
 
@@ -18,29 +31,142 @@ class SessionManager;
 
 class Session : public std::enable_shared_from_this<Session> {
 public:
-    Session(SessionManager& mgr, boost::asio::io_context& io_context);
+    // Either a TCP or a UNIX domain socket.
+    using Socket = boost::asio::generic::stream_protocol::socket;
+
+    // Lines longer than SessionContext::m_max_line_length are read in chunks
+    // this long.
+    static constexpr std::size_t STREAM_CHUNK_SIZE = 16 * 1024;
+    // Pipelined input isn't read while this many bytes of replies are waiting
+    // for the client to read them.
+    static constexpr std::size_t MAX_PENDING_OUTPUT = 256 * 1024;
 
-    boost::asio::ip::tcp::socket& socket();
+    Session(SessionManager& mgr,
+            boost::asio::io_context& io_context,
+            const SessionContext& context);
+
+    Socket& socket();
 
     void start();
     void stop();
 
+    // Makes the session as good as new, so that it can be reused for another
+    // connection, keeping the buffers it's allocated.
+    // Must only be called when nothing else refers to it.
+    void reset();
+    // Not worth keeping if it's buffered a line longer than the default limit
+    // (the buffer doesn't shrink).
+    bool is_reusable() const;
+
 private:
+    // Text unless the client starts with binary::MAGIC.
+    enum class Protocol {
+        UNKNOWN,
+        TEXT,
+        BINARY,
+    };
+
     void close();
 
+    // The io_context's executor, or a strand if several threads run it.
+    // Both allocate the functions they have to queue from m_handler_memory.
+    // A variant rather than boost::asio::executor, which costs an indirect
+    // call and a wrapper object for every handler.
+    using Executor = boost::asio::io_context::basic_executor_type<HandlerAllocator<void>, 0>;
+    using Strand = boost::asio::strand<Executor>;
+
+    static std::variant<Executor, Strand> make_executor(boost::asio::io_context&,
+                                                        const SessionContext&,
+                                                        HandlerMemory&);
+
+    // Starts an operation by passing it the handler, which runs on the
+    // executor, and makes Asio allocate the operation's state from
+    // m_handler_memory.
+    template <typename Operation, typename Handler>
+    void initiate(Operation&&, Handler&&);
+    // Runs the function on the executor; can be called from any thread.
+    template <typename Function>
+    void post(Function&&);
+
+    // Reads a line in text mode, and whatever's available otherwise.
     void read();
-    void write(const std::string&);
+    void read_chunk();
+    // Sends every reply so far at once, unless a write is in progress already.
+    void write();
+    // Unless the client isn't reading the replies.
+    void write_and_read();
 
     void handle_read(const boost::system::error_code&, std::size_t);
+    void handle_read_chunk(const boost::system::error_code&, std::size_t);
     void handle_write(const boost::system::error_code&, std::size_t);
+    // The replies are sent before the session is stopped.
+    void stop_after_write();
+    // The last line might not end with LF, in which case it's added.
+    void terminate_last_line();
+
+    void detect_protocol();
+    // Replies to every complete line (or binary request) buffered so far.
+    void process_input();
+    void process_requests();
+    // The start of a line that doesn't fit into the buffer, which is rejected
+    // right away if it can't be evaluated as it arrives.
+    void stream_line();
+    // Feeds the buffered input to the streaming parser.
+    void stream_input();
+
+    // Long expressions are evaluated on the compute pool, so that the IO
+    // thread can serve other sessions in the meantime.
+    // Nothing else is read or evaluated until the reply is written, which
+    // keeps the replies in order.
+    bool can_offload(const std::string_view& input) const;
+    void offload(const std::string_view& input);
+    void handle_offloaded(const Result<double>&);
+    void handle_offload_error(const std::string& msg);
 
-    std::string consume_input(std::size_t);
+    // Replies are formatted directly into the output buffer.
+    void write_reply(const std::string_view& input);
+    void write_item_reply(const std::string_view& input);
+    bool write_cached_reply(const std::string_view& input);
+    void cache_reply(const std::string_view& input, const Result<double>&, std::size_t offset);
+    void write_command_reply(const std::string_view& input);
+    void write_binary_reply(std::uint32_t id, const std::string_view& input);
+    void write_binary_item(const std::string_view& input);
+    void write_binary_result(const Result<double>&);
+    void write_result(const Result<double>&);
+    void write_output(const std::string_view&);
+    void write_output(double);
 
     SessionManager& m_session_mgr;
+    const SessionContext& m_context;
 
-    boost::asio::io_context::strand m_strand;
-    boost::asio::ip::tcp::socket m_socket;
-    boost::asio::streambuf m_buffer;
+    HandlerMemory m_handler_memory;
+    const std::variant<Executor, Strand> m_executor;
+    Socket m_socket;
+    Protocol m_protocol = Protocol::UNKNOWN;
+    boost::asio::streambuf m_input;
+    // Replies are appended to the pending output while the previous ones are
+    // being sent.
+    std::string m_output;
+    std::string m_sending;
+    bool m_writing = false;
+    bool m_read_paused = false;
+    // The client has shut down its side of the connection; reading again
+    // wouldn't necessarily report that.
+    bool m_input_closed = false;
+    // The rest of a long line that's been replied to already is discarded.
+    bool m_skipping_line = false;
+    bool m_eof = false;
+    // Set by stop(), which might be called from another thread (see
+    // SessionManager::stop_all); the handlers that complete afterwards don't
+    // touch the closed socket.
+    std::atomic<bool> m_stopped{false};
+    std::string m_cache_key;
+    // Only accessed by the compute pool while it's being evaluated.
+    std::string m_offloaded_input;
+    std::uint32_t m_offloaded_id = 0;
+    ParallelParser m_parser;
+    StreamParser m_stream;
+    CommandProcessor m_commands;
 };
 
 } // namespace math::server
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cache/reply_cache.hpp>
+#include <command/registry.hpp>
+#include <common/format.hpp>
+#include <compute/parallel_parser.hpp>
+#include <compute/worker_pool.hpp>
+#include <jit/hot_program.hpp>
+#include <parser/shunting_yard.hpp>
+
+#include <cstddef>
+
+namespace math::server {
+
+// Server-wide settings and state shared by the sessions.
+struct SessionContext {
+    static constexpr std::size_t DEFAULT_OFFLOAD_THRESHOLD = 16 * 1024;
+    static constexpr std::size_t DEFAULT_MAX_LINE_LENGTH = 64 * 1024;
+
+    // See format::number.
+    unsigned m_precision = format::SHORTEST;
+    // See parser::ShuntingYard.
+    std::size_t m_max_depth = parser::DEFAULT_MAX_DEPTH;
+    // Lines (and binary requests, header included) up to this long are
+    // buffered in full, and can be evaluated in parallel.
+    // Longer lines are evaluated serially as they arrive, using memory
+    // proportional to the nesting depth, so raising the limit trades memory
+    // per connection for parallelism.
+    std::size_t m_max_line_length = DEFAULT_MAX_LINE_LENGTH;
+    // Optional.
+    ReplyCache* m_cache = nullptr;
+    // Prepared expressions available to every session (optional).
+    ExpressionRegistry* m_expressions = nullptr;
+    // Long expressions are evaluated serially on the IO threads without a
+    // pool.
+    WorkerPool* m_pool = nullptr;
+    // See ParallelParser.
+    std::size_t m_parallel_threshold = ParallelParser::DEFAULT_THRESHOLD;
+    // Expressions at least this long (in bytes) are evaluated on the pool
+    // instead of the IO threads (0 to never do that).
+    std::size_t m_offload_threshold = DEFAULT_OFFLOAD_THRESHOLD;
+    // See HotProgram.
+    std::size_t m_jit_threshold = HotProgram::DEFAULT_THRESHOLD;
+    // Every io_context is run by a single thread, so the sessions don't
+    // need strands.
+    bool m_single_threaded = false;
+};
+
+} // namespace math::server
@@ -9,36 +9,113 @@
 
 #include <common/log.hpp>
 
+#include <cstddef>
+#include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace math::server {
 
+SessionManager::SessionManager(const SessionContext& context)
+    : m_context{context}, m_shards{std::make_shared<Shards>()} {}
+
 SessionPtr SessionManager::make_session(boost::asio::io_context& io_context) {
-    return std::make_shared<Session>(*this, io_context);
+    std::unique_ptr<Session> session;
+    {
+        auto& shard = get_thread_shard(*m_shards);
+        const auto lck = lock(shard);
+        if (!shard.m_idle.empty()) {
+            session = std::move(shard.m_idle.back());
+            shard.m_idle.pop_back();
+        }
+    }
+    if (!session) {
+        session = std::make_unique<Session>(*this, io_context, m_context);
+    }
+    return SessionPtr{session.release(), Recycler{m_shards, m_context.m_single_threaded}};
 }
 
 void SessionManager::start(const SessionPtr& session) {
-    std::lock_guard<std::mutex> lck{m_mtx};
-    m_sessions.emplace(session);
+    auto& shard = get_shard(session);
+    {
+        const auto lck = lock(shard);
+        shard.m_active.emplace(session);
+    }
     session->start();
 }
 
 void SessionManager::stop(const SessionPtr& session) {
-    std::lock_guard<std::mutex> lck{m_mtx};
-    const auto removed = m_sessions.erase(session) > 0;
+    auto& shard = get_shard(session);
+    bool removed = false;
+    {
+        const auto lck = lock(shard);
+        removed = shard.m_active.erase(session) > 0;
+    }
     if (removed) {
         session->stop();
     }
 }
 
 void SessionManager::stop_all() {
-    std::lock_guard<std::mutex> lck{m_mtx};
-    log::log("Closing the remaining %1% session(s)...", m_sessions.size());
-    for (const auto& session : m_sessions) {
+    std::vector<SessionPtr> sessions;
+    for (auto& shard : *m_shards) {
+        const auto lck = lock(shard);
+        sessions.insert(sessions.end(), shard.m_active.begin(), shard.m_active.end());
+        shard.m_active.clear();
+    }
+    log::log("Closing the remaining %1% session(s)...", sessions.size());
+    // The sessions are recycled, which might take the locks, when they're
+    // released.
+    for (const auto& session : sessions) {
         session->stop();
     }
-    m_sessions.clear();
+}
+
+void SessionManager::Recycler::operator()(Session* ptr) const {
+    std::unique_ptr<Session> session{ptr};
+    const auto shards = m_shards.lock();
+    if (!shards) {
+        return;
+    }
+    if (!session->is_reusable()) {
+        return;
+    }
+    try {
+        session->reset();
+        auto& shard = get_thread_shard(*shards);
+        const auto lck = lock(shard, m_single_threaded);
+        if (shard.m_idle.size() < MAX_IDLE_SESSIONS) {
+            shard.m_idle.emplace_back(std::move(session));
+        }
+    } catch (const std::exception& e) {
+        log::error("%1%: %2%", __func__, e.what());
+    }
+}
+
+std::unique_lock<std::mutex> SessionManager::lock(Shard& shard, bool single_threaded) {
+    if (single_threaded) {
+        return {};
+    }
+    return std::unique_lock<std::mutex>{shard.m_mtx};
+}
+
+std::unique_lock<std::mutex> SessionManager::lock(Shard& shard) const {
+    return lock(shard, m_context.m_single_threaded);
+}
+
+SessionManager::Shard& SessionManager::get_thread_shard(Shards& shards) {
+    const auto hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return shards[hash % shards.size()];
+}
+
+SessionManager::Shard& SessionManager::get_shard(const SessionPtr& session) const {
+    const auto hash = std::hash<const Session*>{}(session.get());
+    // The low bits of a pointer to a heap object are always 0.
+    return (*m_shards)[(hash >> 6) % m_shards->size()];
 }
 
 } // namespace math::server
@@ -5,21 +5,40 @@
 
 #pragma once
 
+#include "session_context.hpp"
+
 #include <boost/asio.hpp>
 
+#include <array>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 #include <unordered_set>
+#include <vector>
 
 namespace math::server {
 
 class Session;
 using SessionPtr = std::shared_ptr<Session>;
 
+// The active sessions are split into shards, each with its own lock, so that
+// connecting and disconnecting clients rarely contend for the same one.
+// Sessions that are done are kept for reuse instead of being freed, along
+// with their buffers.
+// A thread takes the idle sessions from, and returns them to, a shard of its
+// own (usually), so the pools are mostly per-thread.
+// If a single thread uses the manager (see SessionContext::m_single_threaded),
+// the shards aren't locked at all.
+
 class SessionManager {
 public:
-    SessionManager() = default;
+    static constexpr std::size_t NUMOF_SHARDS = 16;
+    // Per shard.
+    static constexpr std::size_t MAX_IDLE_SESSIONS = 64;
+
+    explicit SessionManager(const SessionContext& context);
 
+    // Every session must belong to the same io_context.
     SessionPtr make_session(boost::asio::io_context&);
 
     void start(const SessionPtr&);
@@ -28,8 +47,36 @@ public:
     void stop_all();
 
 private:
-    std::mutex m_mtx;
-    std::unordered_set<SessionPtr> m_sessions;
+    struct Shard {
+        std::mutex m_mtx;
+        std::unordered_set<SessionPtr> m_active;
+        std::vector<std::unique_ptr<Session>> m_idle;
+    };
+
+    using Shards = std::array<Shard, NUMOF_SHARDS>;
+
+    // Returns the session to the pool when it's no longer referenced.
+    // Sessions outliving the manager are simply freed.
+    class Recycler {
+    public:
+        Recycler(const std::shared_ptr<Shards>& shards, bool single_threaded)
+            : m_shards{shards}, m_single_threaded{single_threaded} {}
+
+        void operator()(Session*) const;
+
+    private:
+        std::weak_ptr<Shards> m_shards;
+        bool m_single_threaded;
+    };
+
+    static std::unique_lock<std::mutex> lock(Shard&, bool single_threaded);
+    std::unique_lock<std::mutex> lock(Shard&) const;
+
+    static Shard& get_thread_shard(Shards&);
+    Shard& get_shard(const SessionPtr&) const;
+
+    const SessionContext m_context;
+    const std::shared_ptr<Shards> m_shards;
 };
 
 } // namespace math::server
@@ -5,6 +5,14 @@
 
 #pragma once
 
+#include "session_context.hpp"
+
+#include <common/binary_protocol.hpp>
+#include <common/format.hpp>
+#include <compute/parallel_parser.hpp>
+#include <jit/hot_program.hpp>
+#include <parser/shunting_yard.hpp>
+
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
@@ -19,11 +27,34 @@ namespace math::server {
 
 struct Settings {
     static constexpr unsigned short DEFAULT_PORT = 18000;
+    static constexpr unsigned DEFAULT_DEFER_ACCEPT = 0;
 
     static std::size_t default_threads() { return std::thread::hardware_concurrency(); }
 
-    unsigned short m_port;
-    std::size_t m_threads;
+    static constexpr unsigned DEFAULT_PRECISION = format::SHORTEST;
+    static constexpr std::size_t DEFAULT_CACHE_SIZE = 32 * 1024 * 1024;
+    static constexpr std::size_t DEFAULT_MAX_DEPTH = parser::DEFAULT_MAX_DEPTH;
+    static constexpr std::size_t DEFAULT_MAX_LINE_LENGTH = SessionContext::DEFAULT_MAX_LINE_LENGTH;
+    static constexpr std::size_t DEFAULT_PARALLEL_THRESHOLD = ParallelParser::DEFAULT_THRESHOLD;
+    static constexpr std::size_t DEFAULT_JIT_THRESHOLD = HotProgram::DEFAULT_THRESHOLD;
+    static constexpr std::size_t DEFAULT_OFFLOAD_THRESHOLD =
+        SessionContext::DEFAULT_OFFLOAD_THRESHOLD;
+
+    // 0 to let the OS choose (see Server::get_port()).
+    unsigned short m_port = DEFAULT_PORT;
+    std::size_t m_threads = default_threads();
+    unsigned m_precision = DEFAULT_PRECISION;
+    std::size_t m_cache_size = DEFAULT_CACHE_SIZE;
+    std::size_t m_max_depth = DEFAULT_MAX_DEPTH;
+    std::size_t m_max_line_length = DEFAULT_MAX_LINE_LENGTH;
+    std::size_t m_compute_threads = default_threads();
+    std::size_t m_parallel_threshold = DEFAULT_PARALLEL_THRESHOLD;
+    std::size_t m_jit_threshold = DEFAULT_JIT_THRESHOLD;
+    std::size_t m_offload_threshold = DEFAULT_OFFLOAD_THRESHOLD;
+    bool m_per_core = false;
+    bool m_pin_threads = false;
+    unsigned m_defer_accept = DEFAULT_DEFER_ACCEPT;
+    std::string m_unix_socket;
 
     bool exit_with_usage() const { return m_vm.count("help"); }
 
@@ -39,13 +70,65 @@ public:
         m_visible.add_options()(
             "port,p", po::value(&m_settings.m_port)->default_value(Settings::DEFAULT_PORT),
             "server port number");
+        m_visible.add_options()("unix-socket", po::value(&m_settings.m_unix_socket),
+                                "also listen on a UNIX domain socket at this path");
         m_visible.add_options()(
             "threads,n",
             po::value(&m_settings.m_threads)->default_value(Settings::default_threads()),
-            "number of threads");
+            "number of IO threads");
+        m_visible.add_options()(
+            "per-core", po::bool_switch(&m_settings.m_per_core),
+            "give every IO thread its own event loop and acceptor (needs SO_REUSEPORT)");
+        m_visible.add_options()("pin-threads", po::bool_switch(&m_settings.m_pin_threads),
+                                "pin every IO thread to a CPU (Linux only)");
+        m_visible.add_options()(
+            "defer-accept",
+            po::value(&m_settings.m_defer_accept)->default_value(Settings::DEFAULT_DEFER_ACCEPT),
+            "seconds to wait for the client to send something before accepting a connection "
+            "(Linux only, 0 to disable)");
+        m_visible.add_options()(
+            "precision",
+            po::value(&m_settings.m_precision)->default_value(Settings::DEFAULT_PRECISION),
+            "significant digits in results (0 for the shortest exact representation)");
+        m_visible.add_options()(
+            "cache-size",
+            po::value(&m_settings.m_cache_size)->default_value(Settings::DEFAULT_CACHE_SIZE),
+            "reply cache size in bytes (0 to disable)");
+        m_visible.add_options()(
+            "max-depth",
+            po::value(&m_settings.m_max_depth)->default_value(Settings::DEFAULT_MAX_DEPTH),
+            "maximum expression nesting depth");
+        m_visible.add_options()("max-line-length",
+                                po::value(&m_settings.m_max_line_length)
+                                    ->default_value(Settings::DEFAULT_MAX_LINE_LENGTH),
+                                "maximum length of a line in bytes to buffer it in full; longer "
+                                "lines are evaluated serially as they arrive");
+        m_visible.add_options()(
+            "compute-threads",
+            po::value(&m_settings.m_compute_threads)->default_value(Settings::default_threads()),
+            "number of threads evaluating long expressions (0 to disable)");
+        m_visible.add_options()("parallel-threshold",
+                                po::value(&m_settings.m_parallel_threshold)
+                                    ->default_value(Settings::DEFAULT_PARALLEL_THRESHOLD),
+                                "minimum number of tokens to evaluate an expression in parallel "
+                                "(0 to disable)");
+        m_visible.add_options()(
+            "jit-threshold",
+            po::value(&m_settings.m_jit_threshold)->default_value(Settings::DEFAULT_JIT_THRESHOLD),
+            "executions of a prepared expression to compile it to native code (0 to disable)");
+        m_visible.add_options()("offload-threshold",
+                                po::value(&m_settings.m_offload_threshold)
+                                    ->default_value(Settings::DEFAULT_OFFLOAD_THRESHOLD),
+                                "minimum length of an expression in bytes to evaluate it on the "
+                                "compute threads (0 to disable)");
     }
 
-    static const char* get_short_description() { return "[-h|--help] [-p|--port] [-n|--threads]"; }
+    static const char* get_short_description() {
+        return "[-h|--help] [-p|--port] [--unix-socket] [-n|--threads] [--per-core] "
+               "[--pin-threads] [--defer-accept] [--precision] [--cache-size] [--max-depth] "
+               "[--max-line-length] [--compute-threads] [--parallel-threshold] "
+               "[--jit-threshold] [--offload-threshold]";
+    }
 
     Settings parse(int argc, char* argv[]) {
         namespace po = boost::program_options;
@@ -55,6 +138,7 @@ public:
             return m_settings;
         }
         po::notify(m_settings.m_vm);
+        validate();
         return m_settings;
     }
 
@@ -66,6 +150,22 @@ public:
     }
 
 private:
+    void validate() const {
+        namespace po = boost::program_options;
+
+        if (m_settings.m_precision > format::MAX_PRECISION) {
+            throw po::validation_error{po::validation_error::invalid_option_value, "precision"};
+        }
+        if (m_settings.m_max_depth == 0) {
+            throw po::validation_error{po::validation_error::invalid_option_value, "max-depth"};
+        }
+        // Room for a binary request header, at least.
+        if (m_settings.m_max_line_length <= binary::REQUEST_HEADER_SIZE) {
+            throw po::validation_error{po::validation_error::invalid_option_value,
+                                       "max-line-length"};
+        }
+    }
+
     static std::string extract_filename(const std::string& path) {
         return boost::filesystem::path{path}.filename().string();
     }
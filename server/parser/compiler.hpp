@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "error.hpp"
+#include "program.hpp"
+#include "shunting_yard.hpp"
+
+#include <common/result.hpp>
+#include <lexer/lexer.hpp>
+#include <lexer/token_buffer.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace math::server {
+
+// Compiles expressions into Programs, which can then be evaluated any number
+// of times.
+// Syntax errors are reported by compile(), and evaluation errors (like
+// division by zero) by Program::exec().
+// This means that for input with both, the syntax error is reported, unlike
+// with Parser, which stops at whichever comes first.
+// Expressions can refer to parameters by name, the program then loads the
+// arguments bound to them by position.
+
+class Compiler {
+public:
+    explicit Compiler(std::size_t max_depth = parser::DEFAULT_MAX_DEPTH)
+        : m_yard{m_writer, max_depth} {}
+
+    Compiler(const Compiler&) = delete;
+    Compiler& operator=(const Compiler&) = delete;
+
+    using Params = std::vector<std::string>;
+
+    // Replaces the contents of the program.
+    Status compile(const std::string_view& input, Program& program) {
+        return compile(input, {}, program);
+    }
+
+    Status compile(const std::string_view& input, const Params& params, Program& program) {
+        program.clear();
+        if (const auto status = Lexer::try_tokenize_all(input, m_tokens); !status) {
+            return status;
+        }
+
+        m_writer.m_program = &program;
+        m_writer.m_params = &params;
+        m_yard.reset();
+        m_yard.on_tokens(m_tokens);
+        return m_yard.finish();
+    }
+
+private:
+    struct Writer {
+        void push(double value) { m_program->push(value); }
+
+        Status push_variable(const std::string_view& name) {
+            // There are only a few parameters, a linear search is fine.
+            for (std::size_t i = 0; i < m_params->size(); ++i) {
+                if ((*m_params)[i] == name) {
+                    m_program->load(i);
+                    return success();
+                }
+            }
+            return parser::unknown_variable(name);
+        }
+
+        Status apply(const parser::Operator& op) {
+            m_program->emit(to_opcode(op));
+            return success();
+        }
+
+        static Program::Opcode to_opcode(const parser::Operator& op) {
+            using Opcode = Program::Opcode;
+            using Type = lexer::Token::Type;
+
+            if (op.unary) {
+                return Opcode::NEG;
+            }
+            switch (op.type) {
+                case Type::PLUS:
+                    return Opcode::ADD;
+                case Type::MINUS:
+                    return Opcode::SUB;
+                case Type::ASTERISK:
+                    return Opcode::MUL;
+                case Type::SLASH:
+                    return Opcode::DIV;
+                case Type::CARET:
+                    return Opcode::POW;
+                default:
+                    throw ParserError{"internal: unsupported operator"};
+            }
+        }
+
+        Program* m_program = nullptr;
+        const Params* m_params = nullptr;
+    };
+
+    lexer::TokenBuffer m_tokens;
+    Writer m_writer;
+    parser::ShuntingYard<Writer> m_yard;
+};
+
+} // namespace math::server
@@ -6,14 +6,45 @@
 #pragma once
 
 #include <common/error.hpp>
+#include <common/result.hpp>
+#include <lexer/error.hpp>
 
 #include <string>
+#include <string_view>
 
 namespace math::server {
 
 class ParserError : public Error {
 public:
     explicit ParserError(const std::string& what) : Error{"parser error: " + what} {}
+    explicit ParserError(const ErrorInfo& info) : ParserError{info.get_message()} {}
 };
 
+namespace parser {
+
+// Plain expressions can't have variables, see Compiler for prepared ones.
+inline ErrorInfo unknown_variable(const std::string_view& name) {
+    return {ErrorInfo::Source::PARSER, "unknown variable", name};
+}
+
+[[noreturn]] inline void raise(const ErrorInfo& error) {
+    switch (error.get_source()) {
+        case ErrorInfo::Source::LEXER:
+            throw LexerError{error};
+        default:
+            throw ParserError{error};
+    }
+}
+
+// Same as what() of the exception raise() would throw.
+inline std::string to_string(const ErrorInfo& error) {
+    switch (error.get_source()) {
+        case ErrorInfo::Source::LEXER:
+            return LexerError{error}.what();
+        default:
+            return ParserError{error}.what();
+    }
+}
+
+} // namespace parser
 } // namespace math::server
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "error.hpp"
+#include "operator.hpp"
+#include "shunting_yard.hpp"
+#include "stack.hpp"
+
+#include <common/result.hpp>
+#include <lexer/token_buffer.hpp>
+
+#include <cstddef>
+#include <string_view>
+
+namespace math::server::parser {
+
+// Shunting yard output which evaluates the operators as soon as they're let
+// through.
+
+class Evaluator {
+public:
+    Evaluator() = default;
+
+    Evaluator(const Evaluator&) = delete;
+    Evaluator& operator=(const Evaluator&) = delete;
+
+    void reset() { m_operands.clear(); }
+
+    // Only valid after ShuntingYard::finish() succeeds.
+    double get_result() const { return m_operands.back(); }
+
+    void push(double value) { m_operands.push_back(value); }
+
+    // The error refers to the name, so it must outlive the result.
+    Status push_variable(const std::string_view& name) { return unknown_variable(name); }
+
+    Status apply(const Operator& op) {
+        if (op.unary) {
+            m_operands.back() = -m_operands.back();
+            return success();
+        }
+
+        const auto rhs = m_operands.back();
+        m_operands.pop_back();
+        auto& lhs = m_operands.back();
+
+        const auto result = BinaryOp::from_type(op.type).exec(lhs, rhs);
+        if (!result) {
+            return result.error();
+        }
+        lhs = *result;
+        return success();
+    }
+
+private:
+    Stack<double, INLINE_DEPTH> m_operands;
+};
+
+// Evaluates a range of tokenized input.
+inline Result<double> evaluate(const lexer::TokenBuffer& tokens,
+                               const lexer::TokenBuffer::Range& range,
+                               std::size_t max_depth = DEFAULT_MAX_DEPTH) {
+    Evaluator evaluator;
+    ShuntingYard<Evaluator> yard{evaluator, max_depth};
+    yard.on_tokens(tokens, range);
+    if (const auto status = yard.finish(); !status) {
+        return status.error();
+    }
+    return evaluator.get_result();
+}
+
+} // namespace math::server::parser
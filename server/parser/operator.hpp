@@ -7,6 +7,7 @@
 
 #include "error.hpp"
 
+#include <common/result.hpp>
 #include <lexer/token.hpp>
 #include <lexer/token_type.hpp>
 
@@ -19,8 +20,10 @@ public:
     using Token = lexer::Token;
     using Type = Token::Type;
 
-    static bool is(const Token& token) {
-        switch (token.get_type()) {
+    static bool is(const Token& token) { return is(token.get_type()); }
+
+    static bool is(Type type) {
+        switch (type) {
             case Type::PLUS:
             case Type::MINUS:
             case Type::ASTERISK:
@@ -33,11 +36,13 @@ public:
         }
     }
 
-    static BinaryOp from_token(const Token& token) {
-        if (!is(token)) {
+    static BinaryOp from_token(const Token& token) { return from_type(token.get_type()); }
+
+    static BinaryOp from_type(Type type) {
+        if (!is(type)) {
             throw ParserError{"internal: token is not a binary operator"};
         }
-        return BinaryOp{token};
+        return BinaryOp{type};
     }
 
     static constexpr unsigned min_precedence() { return 0; }
@@ -74,7 +79,7 @@ public:
 
     bool is_left_associative() const { return !is_right_associative(); }
 
-    double exec(double lhs, double rhs) const {
+    Result<double> exec(double lhs, double rhs) const {
         switch (m_type) {
             case Type::PLUS:
                 return lhs + rhs;
@@ -88,7 +93,7 @@ public:
             case Type::SLASH:
                 // Trapping the CPU would be better?
                 if (rhs == 0.) {
-                    throw ParserError{"division by zero"};
+                    return ErrorInfo{ErrorInfo::Source::PARSER, "division by zero"};
                 }
                 return lhs / rhs;
 
@@ -96,12 +101,12 @@ public:
                 return std::pow(lhs, rhs);
 
             default:
-                throw ParserError{"internal: unsupported operator"};
+                return ErrorInfo{ErrorInfo::Source::PARSER, "internal: unsupported operator"};
         }
     }
 
 private:
-    explicit BinaryOp(const Token& token) : m_type{token.get_type()} {}
+    explicit BinaryOp(Type type) : m_type{type} {}
 
     Type m_type;
 };
@@ -6,11 +6,14 @@
 #pragma once
 
 #include "error.hpp"
-#include "operator.hpp"
+#include "evaluator.hpp"
+#include "shunting_yard.hpp"
 
+#include <common/result.hpp>
 #include <lexer/lexer.hpp>
+#include <lexer/token_buffer.hpp>
 
-#include <optional>
+#include <cstddef>
 #include <string_view>
 
 namespace math::server {
@@ -20,107 +23,55 @@ public:
     using Type = lexer::Token::Type;
 
     // I did simple recursive descent parsing a long time ago (see
-    // https://github.com/egor-tensin/simple-interpreter), this appears to be
-    // a finer algorithm for parsing arithmetic expressions.
+    // https://github.com/egor-tensin/simple-interpreter), and this used to be
+    // a recursive operator-precedence parser.
+    // Recursion depth was controlled by the client though, so now the operators
+    // and the operands wait on explicit stacks instead (see
+    // parser::ShuntingYard), and input nested deeper than max_depth is
+    // rejected.
     // Reference: https://en.wikipedia.org/wiki/Operator-precedence_parser
 
-    explicit Parser(const std::string_view& input) : m_lexer{input} {}
+    explicit Parser(const std::string_view& input,
+                    std::size_t max_depth = parser::DEFAULT_MAX_DEPTH)
+        : Parser{input, m_own_tokens, max_depth} {}
 
-    double exec() {
-        const auto result = exec_dmas();
-        if (m_lexer.has_token()) {
-            throw ParserError{"expected a binary operator"};
-        }
-        return result;
-    }
-
-private:
-    // DMAS as in Division, Multiplication, Addition and Subtraction
-    double exec_dmas() { return exec_binary_op(exec_factor(), parser::BinaryOp::min_precedence()); }
-
-    // Exponentiation operator
-    double exec_exp() {
-        return exec_binary_op(exec_atom(), parser::BinaryOp::get_precedence(Type::CARET));
-    }
+    // The buffer can be reused between inputs to avoid memory allocations.
+    Parser(const std::string_view& input,
+           lexer::TokenBuffer& tokens,
+           std::size_t max_depth = parser::DEFAULT_MAX_DEPTH)
+        : m_tokens{tokens},
+          m_lexer_status{Lexer::try_tokenize_all(input, tokens)},
+          m_yard{m_evaluator, max_depth} {}
 
-    double exec_binary_op(double lhs, unsigned min_prec) {
-        for (auto op = peek_operator(min_prec); op.has_value();) {
-            const auto prev = *op;
-            const auto prev_prec = prev.get_precedence();
+    Parser(const Parser&) = delete;
+    Parser& operator=(const Parser&) = delete;
 
-            m_lexer.drop_token();
-            auto rhs = exec_factor();
-
-            for (op = peek_operator(min_prec); op.has_value(); op = peek_operator(min_prec)) {
-                const auto next = *op;
-                const auto next_prec = next.get_precedence();
-
-                {
-                    const auto acc_left_assoc = next.is_left_associative() && next_prec > prev_prec;
-                    const auto acc_right_assoc =
-                        next.is_right_associative() && next_prec == prev_prec;
-                    const auto acc = acc_left_assoc || acc_right_assoc;
-
-                    if (!acc) {
-                        break;
-                    }
-                }
-
-                rhs = exec_binary_op(rhs, next_prec);
-            }
-
-            lhs = prev.exec(lhs, rhs);
-        }
-        return lhs;
-    }
-
-    std::optional<parser::BinaryOp> peek_operator(unsigned min_prec) {
-        const auto token = m_lexer.peek_token();
-        if (!token.has_value() || !parser::BinaryOp::is(*token)) {
-            return {};
-        }
-        const auto op = parser::BinaryOp::from_token(*token);
-        if (op.get_precedence() < min_prec) {
-            return {};
-        }
-        return op;
-    }
-
-    double exec_factor() {
-        if (!m_lexer.has_token()) {
-            throw ParserError{"expected '-', '+', '(' or a number"};
-        }
-        if (m_lexer.drop_token_of_type(Type::MINUS).has_value()) {
-            return -exec_factor();
-        }
-        if (m_lexer.drop_token_of_type(Type::PLUS).has_value()) {
-            return exec_factor();
+    double exec() {
+        const auto result = try_exec();
+        if (!result) {
+            parser::raise(result.error());
         }
-        return exec_exp();
+        return *result;
     }
 
-    double exec_atom() {
-        if (!m_lexer.has_token()) {
-            throw ParserError{"expected '-', '+', '(' or a number"};
-        }
-
-        if (m_lexer.drop_token_of_type(Type::LEFT_PAREN).has_value()) {
-            const auto inner = exec_dmas();
-            if (!m_lexer.has_token() ||
-                !m_lexer.drop_token_of_type(Type::RIGHT_PAREN).has_value()) {
-                throw ParserError{"missing closing ')'"};
-            }
-            return inner;
+    // Invalid input is reported without throwing.
+    Result<double> try_exec() {
+        if (!m_lexer_status) {
+            return m_lexer_status.error();
         }
-
-        if (const auto token = m_lexer.drop_token_of_type(Type::NUMBER); token.has_value()) {
-            return token.value().as_number();
+        m_yard.on_tokens(m_tokens);
+        if (const auto status = m_yard.finish(); !status) {
+            return status.error();
         }
-
-        throw ParserError{"expected '-', '+', '(' or a number"};
+        return m_evaluator.get_result();
     }
 
-    Lexer m_lexer;
+private:
+    lexer::TokenBuffer m_own_tokens;
+    const lexer::TokenBuffer& m_tokens;
+    const Status m_lexer_status;
+    parser::Evaluator m_evaluator;
+    parser::ShuntingYard<parser::Evaluator> m_yard;
 };
 
 } // namespace math::server
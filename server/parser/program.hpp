@@ -0,0 +1,166 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <common/result.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace math::server {
+
+// A compiled expression: opcodes in postfix order and the constants (and
+// arguments) they push.
+// Evaluating it is a single loop over the opcodes, no recursion or parsing
+// involved.
+// See Compiler for how to make one.
+
+class Program {
+public:
+    enum class Opcode : std::uint8_t {
+        // Pushes the next constant.
+        PUSH,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        POW,
+        NEG,
+        // Pushes an argument, its index is the next one in get_variables().
+        LOAD,
+    };
+
+    static bool is_binary(Opcode op) {
+        return op != Opcode::PUSH && op != Opcode::NEG && op != Opcode::LOAD;
+    }
+
+    void clear() {
+        m_code.clear();
+        m_constants.clear();
+        m_variables.clear();
+        m_numof_args = 0;
+        m_depth = 0;
+        m_max_depth = 0;
+    }
+
+    bool empty() const { return m_code.empty(); }
+
+    const std::vector<Opcode>& get_code() const { return m_code; }
+    const std::vector<double>& get_constants() const { return m_constants; }
+    const std::vector<std::size_t>& get_variables() const { return m_variables; }
+
+    // The minimum number of arguments required to evaluate the program.
+    std::size_t get_numof_args() const { return m_numof_args; }
+
+    // The number of stack slots required to evaluate the program.
+    std::size_t get_max_depth() const { return m_max_depth; }
+
+    void push(double value) {
+        m_code.emplace_back(Opcode::PUSH);
+        m_constants.emplace_back(value);
+        m_max_depth = std::max(m_max_depth, ++m_depth);
+    }
+
+    void load(std::size_t arg) {
+        m_code.emplace_back(Opcode::LOAD);
+        m_variables.emplace_back(arg);
+        m_numof_args = std::max(m_numof_args, arg + 1);
+        m_max_depth = std::max(m_max_depth, ++m_depth);
+    }
+
+    void emit(Opcode op) {
+        m_code.emplace_back(op);
+        if (is_binary(op)) {
+            --m_depth;
+        }
+    }
+
+    // The stack can be reused between calls to avoid memory allocations.
+    Result<double> exec(const std::vector<double>& args, std::vector<double>& stack) const {
+        if (m_code.empty() || m_depth != 1) {
+            return error("internal: malformed program");
+        }
+        if (args.size() < m_numof_args) {
+            return error("internal: not enough arguments");
+        }
+        if (stack.size() < m_max_depth) {
+            stack.resize(m_max_depth);
+        }
+
+        const auto s = stack.data();
+        std::size_t top = 0;
+        auto constant = m_constants.data();
+        auto variable = m_variables.data();
+
+        for (const auto op : m_code) {
+            switch (op) {
+                case Opcode::PUSH:
+                    s[top++] = *constant++;
+                    break;
+
+                case Opcode::ADD:
+                    --top;
+                    s[top - 1] += s[top];
+                    break;
+
+                case Opcode::SUB:
+                    --top;
+                    s[top - 1] -= s[top];
+                    break;
+
+                case Opcode::MUL:
+                    --top;
+                    s[top - 1] *= s[top];
+                    break;
+
+                case Opcode::DIV:
+                    --top;
+                    if (s[top] == 0.) {
+                        return error("division by zero");
+                    }
+                    s[top - 1] /= s[top];
+                    break;
+
+                case Opcode::POW:
+                    --top;
+                    s[top - 1] = std::pow(s[top - 1], s[top]);
+                    break;
+
+                case Opcode::NEG:
+                    s[top - 1] = -s[top - 1];
+                    break;
+
+                case Opcode::LOAD:
+                    s[top++] = args[*variable++];
+                    break;
+            }
+        }
+        return s[0];
+    }
+
+    Result<double> exec(std::vector<double>& stack) const { return exec({}, stack); }
+
+    Result<double> exec() const {
+        std::vector<double> stack;
+        return exec(stack);
+    }
+
+private:
+    static ErrorInfo error(const char* msg) { return {ErrorInfo::Source::PARSER, msg}; }
+
+    std::vector<Opcode> m_code;
+    std::vector<double> m_constants;
+    std::vector<std::size_t> m_variables;
+    std::size_t m_numof_args = 0;
+    // Stack depth after the last opcode.
+    std::size_t m_depth = 0;
+    std::size_t m_max_depth = 0;
+};
+
+} // namespace math::server
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <lexer/token.hpp>
+#include <lexer/token_buffer.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace math::server::parser {
+
+// Calls process(term) for every term of a sum: the range is split before
+// every binary + and - outside of any parentheses, since nothing has lower
+// precedence.
+// Every term but the first starts with the operator, which then becomes
+// unary: 1 - 2 * 3 + 4 is split into 1, -2 * 3 and +4.
+// The sum of the terms is the value of the whole range: negation is exact,
+// so a - b is the same as a + (-b), bit for bit.
+// The range must start outside of any parentheses.
+
+template <typename Process>
+void for_each_term(const lexer::TokenBuffer& tokens,
+                   const lexer::TokenBuffer::Range& range,
+                   Process&& process) {
+    using Type = lexer::Token::Type;
+
+    if (range.begin == range.end) {
+        return;
+    }
+
+    auto current = range;
+    std::ptrdiff_t depth = 0;
+    bool after_operand = false;
+    auto numbers = range.first_number;
+    auto identifiers = range.first_identifier;
+
+    for (auto i = range.begin; i < range.end; ++i) {
+        const auto type = tokens.get_type(i);
+        switch (type) {
+            case Type::NUMBER:
+                ++numbers;
+                after_operand = true;
+                break;
+
+            case Type::IDENTIFIER:
+                ++identifiers;
+                after_operand = true;
+                break;
+
+            case Type::LEFT_PAREN:
+                ++depth;
+                after_operand = false;
+                break;
+
+            case Type::RIGHT_PAREN:
+                --depth;
+                after_operand = true;
+                break;
+
+            case Type::PLUS:
+            case Type::MINUS:
+                if (depth == 0 && after_operand) {
+                    current.end = i;
+                    process(current);
+                    current = {i, i, numbers, identifiers};
+                }
+                after_operand = false;
+                break;
+
+            default:
+                after_operand = false;
+                break;
+        }
+    }
+
+    current.end = range.end;
+    process(current);
+}
+
+// Splits tokenized input into segments that can be evaluated independently:
+// runs of consecutive terms (see for_each_term).
+// Segments are at least min_tokens long (except for the last one), and only
+// depend on the input, so that the results are the same from run to run.
+// If every segment is valid, so is the whole input, so invalid input can be
+// split in any old way.
+
+inline void split(const lexer::TokenBuffer& tokens,
+                  std::size_t min_tokens,
+                  std::vector<lexer::TokenBuffer::Range>& segments) {
+    segments.clear();
+    if (tokens.empty()) {
+        return;
+    }
+
+    auto current = tokens.all();
+    for_each_term(tokens, tokens.all(), [&](const lexer::TokenBuffer::Range& term) {
+        if (term.begin > current.begin && term.begin - current.begin >= min_tokens) {
+            current.end = term.begin;
+            segments.emplace_back(current);
+            current = term;
+        }
+    });
+
+    current.end = tokens.size();
+    segments.emplace_back(current);
+}
+
+} // namespace math::server::parser
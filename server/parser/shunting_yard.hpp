@@ -0,0 +1,269 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "operator.hpp"
+#include "stack.hpp"
+
+#include <common/result.hpp>
+#include <lexer/token.hpp>
+#include <lexer/token_buffer.hpp>
+#include <lexer/token_type.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace math::server::parser {
+
+// Expressions nested deeper than this are rejected, which bounds the memory
+// the stacks can take.
+constexpr std::size_t DEFAULT_MAX_DEPTH = 4096;
+
+// The stacks don't allocate memory for expressions up to this deep.
+constexpr std::size_t INLINE_DEPTH = 32;
+
+// The shunting-yard algorithm: operators wait on a stack until an operator of
+// lower precedence (or a closing parenthesis) arrives.
+// Reference: https://en.wikipedia.org/wiki/Shunting-yard_algorithm
+//
+// It doesn't recurse, so deeply nested input can't overflow the thread's
+// stack, the depth is limited explicitly instead.
+//
+// Operands and operators are passed to the output in postfix order, the
+// output either evaluates them right away or records them for later.
+// It must provide these methods:
+//
+//     void push(double);
+//     Status push_variable(const std::string_view& name);
+//     Status apply(const parser::Operator&);
+
+struct Operator {
+    using Type = lexer::Token::Type;
+
+    // Between * and / and ^: -2 ^ 2 is -(2 ^ 2), and -2 * 3 is (-2) * 3.
+    static constexpr unsigned NEG_PRECEDENCE = BinaryOp::min_precedence() + 2;
+
+    unsigned get_precedence() const {
+        if (unary) {
+            return NEG_PRECEDENCE;
+        }
+        return BinaryOp::get_precedence(type);
+    }
+
+    // Either a binary operator, the unary minus, or an opening parenthesis.
+    Type type;
+    bool unary;
+};
+
+template <typename Output>
+class ShuntingYard {
+public:
+    using Type = lexer::Token::Type;
+
+    // The depth is the number of operators (opening parentheses included)
+    // waiting on the stack.
+    explicit ShuntingYard(Output& output, std::size_t max_depth = DEFAULT_MAX_DEPTH)
+        : m_output{output}, m_max_depth{max_depth} {}
+
+    ShuntingYard(const ShuntingYard&) = delete;
+    ShuntingYard& operator=(const ShuntingYard&) = delete;
+
+    void reset() {
+        m_operators.clear();
+        m_expect_operand = true;
+        m_error = {};
+    }
+
+    bool failed() const { return m_error.has_value(); }
+
+    // Anything but a number or an identifier.
+    void on_token(Type type) {
+        if (failed()) {
+            return;
+        }
+        if (m_expect_operand) {
+            on_operand_token(type);
+        } else {
+            on_operator_token(type);
+        }
+    }
+
+    void on_number(double value) {
+        if (failed()) {
+            return;
+        }
+        if (!m_expect_operand) {
+            unexpected_operand();
+            return;
+        }
+        m_output.push(value);
+        m_expect_operand = false;
+    }
+
+    // Feeds a whole tokenized input.
+    void on_tokens(const lexer::TokenBuffer& tokens) { on_tokens(tokens, tokens.all()); }
+
+    void on_tokens(const lexer::TokenBuffer& tokens, const lexer::TokenBuffer::Range& range) {
+        auto next_number = range.first_number;
+        auto next_identifier = range.first_identifier;
+        for (auto i = range.begin; i < range.end && !failed(); ++i) {
+            const auto type = tokens.get_type(i);
+            if (type == Type::NUMBER) {
+                on_number(tokens.get_number(next_number++));
+            } else if (type == Type::IDENTIFIER) {
+                on_identifier(tokens.get_identifier(next_identifier++));
+            } else {
+                on_token(type);
+            }
+        }
+    }
+
+    void on_identifier(const std::string_view& name) {
+        if (failed()) {
+            return;
+        }
+        if (!m_expect_operand) {
+            unexpected_operand();
+            return;
+        }
+        if (const auto status = m_output.push_variable(name); !status) {
+            m_error = status.error();
+            return;
+        }
+        m_expect_operand = false;
+    }
+
+    // Signals the end of input.
+    Status finish() {
+        if (failed()) {
+            return *m_error;
+        }
+        if (m_expect_operand) {
+            return expected_operand();
+        }
+        if (!reduce_until_paren()) {
+            return *m_error;
+        }
+        if (!m_operators.empty()) {
+            return missing_paren();
+        }
+        return success();
+    }
+
+private:
+    static ErrorInfo error(const char* msg) { return {ErrorInfo::Source::PARSER, msg}; }
+
+    static ErrorInfo expected_operand() { return error("expected '-', '+', '(' or a number"); }
+    static ErrorInfo expected_binary_op() { return error("expected a binary operator"); }
+    static ErrorInfo missing_paren() { return error("missing closing ')'"); }
+    static ErrorInfo too_deep() { return error("expression is nested too deeply"); }
+
+    void push_operator(const Operator& op) {
+        if (m_operators.size() >= m_max_depth) {
+            m_error = too_deep();
+            return;
+        }
+        m_operators.push_back(op);
+    }
+
+    void on_operand_token(Type type) {
+        switch (type) {
+            case Type::MINUS:
+                // Two unary minuses cancel each other out, so that they don't
+                // pile up on the stack.
+                if (!m_operators.empty() && m_operators.back().unary) {
+                    m_operators.pop_back();
+                } else {
+                    push_operator({type, true});
+                }
+                return;
+
+            case Type::PLUS:
+                return;
+
+            case Type::LEFT_PAREN:
+                push_operator({type, false});
+                return;
+
+            default:
+                m_error = expected_operand();
+                return;
+        }
+    }
+
+    void on_operator_token(Type type) {
+        if (type == Type::RIGHT_PAREN) {
+            if (!reduce_until_paren()) {
+                return;
+            }
+            if (m_operators.empty()) {
+                m_error = expected_binary_op();
+                return;
+            }
+            m_operators.pop_back();
+            return;
+        }
+        if (!BinaryOp::is(type)) {
+            unexpected_operand();
+            return;
+        }
+
+        const auto op = BinaryOp::from_type(type);
+        const auto prec = op.get_precedence();
+        while (!m_operators.empty() && m_operators.back().type != Type::LEFT_PAREN) {
+            const auto top_prec = m_operators.back().get_precedence();
+            const auto reduce =
+                top_prec > prec || (top_prec == prec && op.is_left_associative());
+            if (!reduce) {
+                break;
+            }
+            if (!reduce_one()) {
+                return;
+            }
+        }
+        push_operator({type, false});
+        m_expect_operand = true;
+    }
+
+    // Everything up to the enclosing parenthesis is evaluated before the extra
+    // token is reported, so "1 / 0 2" is a division by zero.
+    void unexpected_operand() {
+        if (!reduce_until_paren()) {
+            return;
+        }
+        m_error = m_operators.empty() ? expected_binary_op() : missing_paren();
+    }
+
+    bool reduce_until_paren() {
+        while (!m_operators.empty() && m_operators.back().type != Type::LEFT_PAREN) {
+            if (!reduce_one()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool reduce_one() {
+        const auto op = m_operators.back();
+        m_operators.pop_back();
+        if (const auto status = m_output.apply(op); !status) {
+            m_error = status.error();
+            return false;
+        }
+        return true;
+    }
+
+    Output& m_output;
+    const std::size_t m_max_depth;
+
+    Stack<Operator, INLINE_DEPTH> m_operators;
+    bool m_expect_operand = true;
+
+    std::optional<ErrorInfo> m_error;
+};
+
+} // namespace math::server::parser
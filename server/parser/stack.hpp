@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace math::server::parser {
+
+// A stack with room for the first few elements reserved inline, so that
+// parsing a shallow expression doesn't allocate memory at all.
+// Deeper expressions spill over to the heap, the memory is then kept until
+// the stack is destroyed.
+
+template <typename T, std::size_t N>
+class Stack {
+    static_assert(std::is_trivially_copyable<T>::value);
+    static_assert(N > 0);
+
+public:
+    Stack() = default;
+
+    Stack(const Stack&) = delete;
+    Stack& operator=(const Stack&) = delete;
+
+    bool empty() const { return m_size == 0; }
+    std::size_t size() const { return m_size; }
+
+    void clear() { m_size = 0; }
+
+    T& back() { return m_data[m_size - 1]; }
+    const T& back() const { return m_data[m_size - 1]; }
+
+    void push_back(const T& x) {
+        if (m_size == m_capacity) {
+            grow();
+        }
+        m_data[m_size++] = x;
+    }
+
+    void pop_back() { --m_size; }
+
+private:
+    void grow() {
+        const auto capacity = m_capacity * 2;
+        auto heap = std::make_unique<T[]>(capacity);
+        std::memcpy(heap.get(), m_data, m_size * sizeof(T));
+        m_heap = std::move(heap);
+        m_data = m_heap.get();
+        m_capacity = capacity;
+    }
+
+    std::array<T, N> m_inline;
+    std::unique_ptr<T[]> m_heap;
+    T* m_data = m_inline.data();
+    std::size_t m_size = 0;
+    std::size_t m_capacity = N;
+};
+
+} // namespace math::server::parser
@@ -0,0 +1,75 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include "evaluator.hpp"
+#include "shunting_yard.hpp"
+
+#include <common/result.hpp>
+#include <lexer/stream_lexer.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace math::server {
+
+// Evaluates input that arrives in chunks as the tokens come in, so that the
+// input doesn't have to be buffered.
+// The memory required is proportional to the nesting depth of the expression,
+// not its length.
+
+class StreamParser : private StreamLexer::Sink {
+public:
+    using Type = lexer::Token::Type;
+
+    explicit StreamParser(std::size_t max_depth = parser::DEFAULT_MAX_DEPTH)
+        : m_lexer{*this}, m_yard{m_evaluator, max_depth} {}
+
+    StreamParser(const StreamParser&) = delete;
+    StreamParser& operator=(const StreamParser&) = delete;
+
+    // Readies the parser for another input.
+    void reset() {
+        m_lexer.reset();
+        m_yard.reset();
+        m_evaluator.reset();
+    }
+
+    void feed(const std::string_view& chunk) { m_lexer.feed(chunk); }
+
+    // Signals the end of input.
+    // The error (if any) is valid until the next reset().
+    Result<double> finish() {
+        // Lexer errors take precedence, same as in Parser.
+        if (const auto status = m_lexer.finish(); !status) {
+            return status.error();
+        }
+        if (const auto status = m_yard.finish(); !status) {
+            return status.error();
+        }
+        return m_evaluator.get_result();
+    }
+
+private:
+    void on_token(Type type) override { m_yard.on_token(type); }
+    void on_number(double value) override { m_yard.on_number(value); }
+    void on_identifier(const std::string_view& name) override {
+        if (m_yard.failed()) {
+            return;
+        }
+        // The name doesn't outlive the call, and the error refers to it.
+        m_identifier.assign(name);
+        m_yard.on_identifier(m_identifier);
+    }
+
+    StreamLexer m_lexer;
+    parser::Evaluator m_evaluator;
+    parser::ShuntingYard<parser::Evaluator> m_yard;
+    std::string m_identifier;
+};
+
+} // namespace math::server
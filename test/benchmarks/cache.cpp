@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "corpus.hpp"
+
+#include <cache/reply_cache.hpp>
+#include <parser/parser.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A cache hit should be a lot cheaper than evaluating the expression, even
+// with every thread hammering the cache at once.
+
+namespace {
+
+constexpr std::size_t NUMOF_EXPRESSIONS = 1024;
+constexpr std::size_t NUMOF_OPERATORS = 10;
+
+const std::vector<std::string>& get_inputs() {
+    static const auto inputs = corpus::Generator{}.many(
+        NUMOF_EXPRESSIONS, [](corpus::Generator& gen) { return gen.stress_test(NUMOF_OPERATORS); });
+    return inputs;
+}
+
+math::server::ReplyCache& get_cache() {
+    static math::server::ReplyCache cache = [] {
+        math::server::ReplyCache cache{64 * 1024 * 1024};
+        std::string key;
+        for (const auto& input : get_inputs()) {
+            math::server::ReplyCache::normalize(input, key);
+            cache.insert(key, std::to_string(math::server::Parser{input}.exec()));
+        }
+        return cache;
+    }();
+    return cache;
+}
+
+void Evaluate(benchmark::State& state) {
+    const auto& inputs = get_inputs();
+    math::server::lexer::TokenBuffer tokens;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& input = inputs[i++ % inputs.size()];
+        benchmark::DoNotOptimize(math::server::Parser{input, tokens}.try_exec());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void CacheHit(benchmark::State& state) {
+    const auto& inputs = get_inputs();
+    auto& cache = get_cache();
+    std::string key, reply;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& input = inputs[i++ % inputs.size()];
+        math::server::ReplyCache::normalize(input, key);
+        benchmark::DoNotOptimize(
+            cache.find(key, [&reply](const std::string_view& cached) { reply = cached; }));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(Evaluate);
+BENCHMARK(CacheHit)->ThreadRange(1, 4);
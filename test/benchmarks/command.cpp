@@ -0,0 +1,93 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <command/processor.hpp>
+#include <lexer/token_buffer.hpp>
+#include <parser/parser.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The same formula with different numbers, either sent in full every time or
+// prepared once and executed with different arguments.
+
+namespace {
+
+constexpr std::size_t NUMOF_REQUESTS = 64;
+
+using Args = std::vector<std::string>;
+
+std::string make_formula(const Args& args) {
+    const auto& price = args[0];
+    const auto& rate = args[1];
+    const auto& years = args[2];
+    const auto& fee = args[3];
+    const auto& discount = args[4];
+    return price + " * (1 + " + rate + " / 12) ^ (12 * " + years + ") - " + fee + " * (1 - " +
+           discount + ") / (1 + " + rate + ")";
+}
+
+std::vector<Args> make_args() {
+    std::vector<Args> result;
+    for (std::size_t i = 0; i < NUMOF_REQUESTS; ++i) {
+        const auto n = std::to_string(i);
+        result.push_back({"1000" + n, "0.0" + n, n, "12.5", "0." + n});
+    }
+    return result;
+}
+
+std::string join(const Args& args) {
+    std::string result;
+    for (const auto& arg : args) {
+        if (!result.empty()) {
+            result += ", ";
+        }
+        result += arg;
+    }
+    return result;
+}
+
+void Reparse(benchmark::State& state) {
+    std::vector<std::string> inputs;
+    for (const auto& args : make_args()) {
+        inputs.emplace_back(make_formula(args));
+    }
+    math::server::lexer::TokenBuffer tokens;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& input = inputs[i++ % inputs.size()];
+        benchmark::DoNotOptimize(math::server::Parser{input, tokens}.try_exec());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void Execute(benchmark::State& state) {
+    const Args params{"price", "rate", "years", "fee", "discount"};
+    math::server::CommandProcessor processor;
+    const auto prepared =
+        processor.exec("prepare f(" + join(params) + ") = " + make_formula(params));
+    if (!prepared) {
+        throw std::logic_error{"couldn't prepare the formula"};
+    }
+    std::vector<std::string> inputs;
+    for (const auto& args : make_args()) {
+        inputs.emplace_back("execute f(" + join(args) + ")");
+    }
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const auto& input = inputs[i++ % inputs.size()];
+        benchmark::DoNotOptimize(processor.exec(input));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(Reparse);
+BENCHMARK(Execute);
@@ -0,0 +1,89 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "corpus.hpp"
+
+#include <compute/parallel_parser.hpp>
+#include <compute/worker_pool.hpp>
+#include <lexer/token_buffer.hpp>
+#include <parser/parser.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+
+// A single long expression, evaluated on one thread or split between several.
+// The speedup is bounded by the number of cores, of course.
+// ParallelParser only splits the input if that can't change the result, so
+// the stress test's expressions (which have divisions) are evaluated serially
+// after all.
+
+namespace {
+
+constexpr std::size_t NUMOF_OPERATORS = 100000;
+
+const std::string& get_input() {
+    static const std::string input = corpus::Generator{}.stress_test(NUMOF_OPERATORS);
+    return input;
+}
+
+// Small integers, which are added up exactly in any order:
+// 0 * 3 + 1 * 3 - 2 * 3 + ...
+const std::string& get_exact_input() {
+    static const std::string input = []() {
+        std::string result;
+        for (std::size_t i = 0; i < NUMOF_OPERATORS / 2; ++i) {
+            if (i != 0) {
+                result += i % 2 == 0 ? " + " : " - ";
+            }
+            result += std::to_string(i % 1000);
+            result += " * 3";
+        }
+        return result;
+    }();
+    return input;
+}
+
+void serial(benchmark::State& state, const std::string& input) {
+    math::server::lexer::TokenBuffer tokens;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(math::server::Parser{input, tokens}.try_exec());
+    }
+    state.SetBytesProcessed(state.iterations() * input.length());
+}
+
+void parallel(benchmark::State& state, const std::string& input) {
+    // The calling thread is one of the threads.
+    math::server::WorkerPool pool{static_cast<std::size_t>(state.range(0)) - 1};
+    math::server::ParallelParser parser{&pool};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.try_exec(input));
+    }
+    state.SetBytesProcessed(state.iterations() * input.length());
+}
+
+void Serial(benchmark::State& state) {
+    serial(state, get_input());
+}
+
+void Parallel(benchmark::State& state) {
+    parallel(state, get_input());
+}
+
+void SerialExact(benchmark::State& state) {
+    serial(state, get_exact_input());
+}
+
+void ParallelExact(benchmark::State& state) {
+    parallel(state, get_exact_input());
+}
+
+} // namespace
+
+BENCHMARK(Serial)->UseRealTime();
+BENCHMARK(Parallel)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(SerialExact)->UseRealTime();
+BENCHMARK(ParallelExact)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
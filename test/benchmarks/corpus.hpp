@@ -0,0 +1,125 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace corpus {
+
+// Generates random, but reproducible arithmetic expressions.
+// The random number engines are fully specified by the standard, unlike the
+// distributions, so the latter are avoided here.
+
+class Generator {
+public:
+    static constexpr std::uint64_t DEFAULT_SEED = 20200101;
+
+    explicit Generator(std::uint64_t seed = DEFAULT_SEED) : m_engine{seed} {}
+
+    // Same as ExprGen in stress_test.py: random integers and +, -, * or /
+    // between them.
+    std::string stress_test(std::size_t numof_operators) {
+        std::string result;
+        for (std::size_t i = 0; i < numof_operators; ++i) {
+            result += std::to_string(random_number());
+            result += ' ';
+            result += random_operator();
+            result += ' ';
+        }
+        result += std::to_string(random_number());
+        return result;
+    }
+
+    // ((((1 + 2) * 3) - 4) / 5)...
+    std::string nested_parens(std::size_t depth) {
+        std::string result(depth, '(');
+        result += std::to_string(random_number());
+        for (std::size_t i = 0; i < depth; ++i) {
+            result += ' ';
+            result += random_operator();
+            result += ' ';
+            result += std::to_string(random_number());
+            result += ')';
+        }
+        return result;
+    }
+
+    // 1.0001 ^ 0.9999 ^ 1.0002 ^ ..., which is evaluated right-to-left.
+    std::string power_chain(std::size_t length) {
+        std::string result;
+        for (std::size_t i = 0; i < length; ++i) {
+            result += random_exponent();
+            result += " ^ ";
+        }
+        result += random_exponent();
+        return result;
+    }
+
+    // Same as stress_test, but broken in a random way somewhere in the middle.
+    std::string invalid(std::size_t numof_operators) {
+        auto result = stress_test(numof_operators);
+        auto pos = result.find(' ', random_int(0, result.length() / 2));
+        if (pos == std::string::npos) {
+            pos = result.length();
+        }
+        switch (random_int(0, 3)) {
+            case 0:
+                result.insert(pos, " (");
+                break;
+            case 1:
+                result.insert(pos, " / 0");
+                break;
+            case 2:
+                result.insert(pos, " 1e");
+                break;
+            default:
+                result.insert(pos, " & ");
+                break;
+        }
+        return result;
+    }
+
+    template <typename Generate>
+    std::vector<std::string> many(std::size_t numof_expressions, Generate&& generate) {
+        std::vector<std::string> result;
+        for (std::size_t i = 0; i < numof_expressions; ++i) {
+            result.emplace_back(generate(*this));
+        }
+        return result;
+    }
+
+private:
+    static constexpr std::int64_t MIN_NUMBER = -100000000000;
+    static constexpr std::int64_t MAX_NUMBER = 100000000000;
+
+    // [min, max]; the modulo bias doesn't matter here.
+    std::uint64_t random_int(std::uint64_t min, std::uint64_t max) {
+        return min + m_engine() % (max - min + 1);
+    }
+
+    std::int64_t random_number() {
+        const auto range = static_cast<std::uint64_t>(MAX_NUMBER - MIN_NUMBER);
+        return MIN_NUMBER + static_cast<std::int64_t>(random_int(0, range));
+    }
+
+    char random_operator() {
+        static constexpr char operators[] = {'+', '-', '*', '/'};
+        return operators[random_int(0, 3)];
+    }
+
+    // Close to 1, so that long chains don't overflow.
+    std::string random_exponent() {
+        return (random_int(0, 1) ? "1.000" : "0.999") + std::to_string(random_int(1, 9));
+    }
+
+    std::mt19937_64 m_engine;
+};
+
+} // namespace corpus
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <jit/native_program.hpp>
+#include <parser/compiler.hpp>
+#include <parser/program.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// The same prepared expression, either interpreted or compiled to native code.
+
+namespace {
+
+constexpr std::size_t NUMOF_ARGS = 64;
+
+math::server::Program make_program() {
+    math::server::Program program;
+    math::server::Compiler compiler;
+    const auto status =
+        compiler.compile("a * (1 + b / 12) ^ (12 * c) - d * (1 - e) / (1 + b) + a * b - c / d * e",
+                         {"a", "b", "c", "d", "e"}, program);
+    if (!status) {
+        throw std::logic_error{"couldn't compile the expression"};
+    }
+    return program;
+}
+
+std::vector<std::vector<double>> make_args() {
+    std::vector<std::vector<double>> result;
+    for (std::size_t i = 0; i < NUMOF_ARGS; ++i) {
+        const auto x = static_cast<double>(i);
+        result.push_back({1000 + x, 0.01 * x, x, 12.5, 0.1 + x / 100});
+    }
+    return result;
+}
+
+void Interpret(benchmark::State& state) {
+    const auto program = make_program();
+    const auto args = make_args();
+    std::vector<double> stack;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(program.exec(args[i++ % args.size()], stack));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void Native(benchmark::State& state) {
+    const auto native = math::server::NativeProgram::compile(make_program());
+    if (!native) {
+        state.SkipWithError("the JIT is not supported");
+        return;
+    }
+    const auto args = make_args();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(native->exec(args[i++ % args.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(Interpret);
+BENCHMARK(Native);
@@ -3,10 +3,13 @@
 // For details, see https://github.com/egor-tensin/math-server.
 // Distributed under the MIT License.
 
+#include <lexer/details/classify.hpp>
 #include <lexer/details/parse.hpp>
 
 #include <benchmark/benchmark.h>
 
+#include <cstddef>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -14,6 +17,8 @@
 // Switching to boost::regex_search yielded a huge benefit: sometimes a 15x
 // increase in regex matching (on VS builds in particular).
 // Should be easily reproducible using these micro-benchmarks.
+// The hand-written DFA leaves both of them far behind, especially on plain
+// integers.
 
 namespace {
 
@@ -26,10 +31,29 @@ protected:
         ".123",
         "1e9",
         "1.87E-18",
+        "12345678901",
         "012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789.012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789",
     };
 };
 
+class ConstTokenExamples : public benchmark::Fixture {
+protected:
+    // Operator-heavy input, every byte is a separate token.
+    std::string_view m_tokens{"-(-(+-(+-*/^)*-(-^--++)/(^^**//)))+-(-(+-(+-*/^)*-(-^--++)))"};
+
+    template <typename Parse>
+    void parse_all(benchmark::State& state, Parse&& parse) {
+        for (auto _ : state) {
+            for (auto input = m_tokens; !input.empty();) {
+                std::string_view token;
+                benchmark::DoNotOptimize(parse(input, token));
+                input.remove_prefix(token.length());
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * m_tokens.length());
+    }
+};
+
 class WhitespaceExamples : public benchmark::Fixture {
 protected:
     std::vector<std::string_view> m_whitespace{
@@ -39,6 +63,41 @@ protected:
     };
 };
 
+class LineExamples : public benchmark::Fixture {
+protected:
+    using CharMap = math::server::lexer::details::CharMap;
+
+    void SetUp(const benchmark::State&) override {
+        m_lines.clear();
+        std::string line;
+        for (int i = 0; i < 1000; ++i) {
+            line += "12345678901 * (-98765432109 /  2e-3) ^ ";
+        }
+        line += "1";
+        m_lines.emplace_back(line);
+        // Garbage is rejected early on.
+        m_lines.emplace_back(std::string(4096, ' ') + "GET / HTTP/1.1");
+    }
+
+    void classify_all(benchmark::State& state, CharMap::Impl impl) {
+        if (!CharMap::is_supported(impl)) {
+            state.SkipWithError("not supported by this CPU");
+            return;
+        }
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            for (const auto& line : m_lines) {
+                const CharMap map{line, impl};
+                benchmark::DoNotOptimize(map.find_invalid());
+                bytes += line.length();
+            }
+        }
+        state.SetBytesProcessed(bytes);
+    }
+
+    std::vector<std::string> m_lines;
+};
+
 } // namespace
 
 BENCHMARK_F(NumberExamples, StdParseNumber)(benchmark::State& state) {
@@ -59,6 +118,29 @@ BENCHMARK_F(NumberExamples, BoostParseNumber)(benchmark::State& state) {
     }
 }
 
+BENCHMARK_F(NumberExamples, DfaParseNumber)(benchmark::State& state) {
+    using namespace math::server::lexer::details;
+    for (auto _ : state) {
+        for (const auto& src : m_numbers) {
+            impl::dfa_parse_number(src);
+        }
+    }
+}
+
+BENCHMARK_F(ConstTokenExamples, SetParseConstToken)(benchmark::State& state) {
+    using namespace math::server::lexer::details;
+    parse_all(state, [](const std::string_view& input, std::string_view& token) {
+        return impl::set_parse_const_token(input, token);
+    });
+}
+
+BENCHMARK_F(ConstTokenExamples, TableParseConstToken)(benchmark::State& state) {
+    using namespace math::server::lexer::details;
+    parse_all(state, [](const std::string_view& input, std::string_view& token) {
+        return impl::table_parse_const_token(input, token);
+    });
+}
+
 BENCHMARK_F(WhitespaceExamples, StdParseWhitespace)(benchmark::State& state) {
     using namespace math::server::lexer::details;
     for (auto _ : state) {
@@ -76,3 +158,25 @@ BENCHMARK_F(WhitespaceExamples, BoostParseWhitespace)(benchmark::State& state) {
         }
     }
 }
+
+BENCHMARK_F(WhitespaceExamples, CharMapSkipWhitespace)(benchmark::State& state) {
+    using namespace math::server::lexer::details;
+    for (auto _ : state) {
+        for (const auto& src : m_whitespace) {
+            const CharMap map{src};
+            benchmark::DoNotOptimize(map.skip_whitespace(0));
+        }
+    }
+}
+
+BENCHMARK_F(LineExamples, ScalarClassify)(benchmark::State& state) {
+    classify_all(state, CharMap::Impl::SCALAR);
+}
+
+BENCHMARK_F(LineExamples, Sse2Classify)(benchmark::State& state) {
+    classify_all(state, CharMap::Impl::SSE2);
+}
+
+BENCHMARK_F(LineExamples, Avx2Classify)(benchmark::State& state) {
+    classify_all(state, CharMap::Impl::AVX2);
+}
@@ -0,0 +1,276 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "corpus.hpp"
+
+#include <lexer/lexer.hpp>
+#include <lexer/token_buffer.hpp>
+#include <parser/compiler.hpp>
+#include <parser/error.hpp>
+#include <parser/parser.hpp>
+#include <parser/program.hpp>
+#include <parser/stream_parser.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Invalid input used to be reported by throwing an exception, which made it
+// a lot more expensive than valid input.
+// These compare the two paths on inputs of the same size.
+
+namespace {
+
+class ErrorExamples : public benchmark::Fixture {
+protected:
+    void SetUp(const benchmark::State&) override {
+        m_valid.clear();
+        m_invalid.clear();
+        for (int n : {1, 10, 100}) {
+            std::string valid;
+            for (int i = 0; i < n; ++i) {
+                valid += "12345678901 * (3 - 98765432109) / 7 + ";
+            }
+            m_valid.emplace_back(valid + "1");
+            // These fail at the very end, after everything has been parsed.
+            m_invalid.emplace_back(valid + "1 / 0");
+            m_invalid.emplace_back(valid + "(1");
+        }
+        // Garbage is rejected by the lexer right away.
+        m_invalid.emplace_back(std::string(1024, '$'));
+    }
+
+    template <typename Exec>
+    void exec_all(benchmark::State& state, const std::vector<std::string>& inputs, Exec&& exec) {
+        math::server::lexer::TokenBuffer tokens;
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            for (const auto& input : inputs) {
+                exec(input, tokens);
+                bytes += input.length();
+            }
+        }
+        state.SetBytesProcessed(bytes);
+        state.SetItemsProcessed(state.iterations() * inputs.size());
+    }
+
+    static void try_exec(const std::string& input, math::server::lexer::TokenBuffer& tokens) {
+        const auto result = math::server::Parser{input, tokens}.try_exec();
+        if (!result) {
+            benchmark::DoNotOptimize(math::server::parser::to_string(result.error()));
+        }
+        benchmark::DoNotOptimize(result);
+    }
+
+    static void exec(const std::string& input, math::server::lexer::TokenBuffer& tokens) {
+        try {
+            benchmark::DoNotOptimize(math::server::Parser{input, tokens}.exec());
+        } catch (const std::exception& e) {
+            benchmark::DoNotOptimize(std::string{e.what()});
+        }
+    }
+
+    std::vector<std::string> m_valid;
+    std::vector<std::string> m_invalid;
+};
+
+} // namespace
+
+BENCHMARK_F(ErrorExamples, ValidTryExec)(benchmark::State& state) {
+    exec_all(state, m_valid, try_exec);
+}
+
+BENCHMARK_F(ErrorExamples, InvalidTryExec)(benchmark::State& state) {
+    exec_all(state, m_invalid, try_exec);
+}
+
+BENCHMARK_F(ErrorExamples, InvalidExec)(benchmark::State& state) {
+    exec_all(state, m_invalid, exec);
+}
+
+// End-to-end benchmarks on generated expressions.
+// The argument is the expression length (the number of operators, the nesting
+// depth, etc.), so that it's easy to see how things scale.
+
+namespace {
+
+class Corpus : public benchmark::Fixture {
+protected:
+    static constexpr std::size_t NUMOF_EXPRESSIONS = 16;
+
+    void SetUp(const benchmark::State& state) override {
+        const auto length = static_cast<std::size_t>(state.range(0));
+        corpus::Generator generator;
+        m_inputs = generator.many(NUMOF_EXPRESSIONS, [this, length](corpus::Generator& gen) {
+            return generate(gen, length);
+        });
+    }
+
+    virtual std::string generate(corpus::Generator&, std::size_t length) = 0;
+
+    void get_tokens(benchmark::State& state) const {
+        process_all(state, [](const std::string_view& input) {
+            benchmark::DoNotOptimize(math::server::Lexer{input}.get_tokens());
+        });
+    }
+
+    void exec(benchmark::State& state) const {
+        math::server::lexer::TokenBuffer tokens;
+        process_all(state, [&tokens](const std::string_view& input) {
+            benchmark::DoNotOptimize(math::server::Parser{input, tokens}.exec());
+        });
+    }
+
+    void try_exec(benchmark::State& state) const {
+        math::server::lexer::TokenBuffer tokens;
+        process_all(state, [&tokens](const std::string_view& input) {
+            benchmark::DoNotOptimize(math::server::Parser{input, tokens}.try_exec());
+        });
+    }
+
+    void compile_exec(benchmark::State& state) const {
+        math::server::Compiler compiler;
+        math::server::Program program;
+        std::vector<double> stack;
+        process_all(state, [&](const std::string_view& input) {
+            compiler.compile(input, program);
+            benchmark::DoNotOptimize(program.exec(stack));
+        });
+    }
+
+    // Excludes compilation, as if the programs were cached.
+    void program_exec(benchmark::State& state) const {
+        math::server::Compiler compiler;
+        std::vector<math::server::Program> programs{m_inputs.size()};
+        for (std::size_t i = 0; i < m_inputs.size(); ++i) {
+            compiler.compile(m_inputs[i], programs[i]);
+        }
+        std::vector<double> stack;
+        std::size_t i = 0;
+        process_all(state, [&](const std::string_view&) {
+            benchmark::DoNotOptimize(programs[i++ % programs.size()].exec(stack));
+        });
+    }
+
+    void stream_exec(benchmark::State& state) const {
+        math::server::StreamParser parser;
+        process_all(state, [&parser](const std::string_view& input) {
+            parser.reset();
+            parser.feed(input);
+            benchmark::DoNotOptimize(parser.finish());
+        });
+    }
+
+private:
+    template <typename Process>
+    void process_all(benchmark::State& state, Process&& process) const {
+        std::size_t bytes = 0;
+        for (auto _ : state) {
+            for (const auto& input : m_inputs) {
+                process(input);
+                bytes += input.length();
+            }
+        }
+        state.SetBytesProcessed(bytes);
+        state.SetItemsProcessed(state.iterations() * m_inputs.size());
+    }
+
+    std::vector<std::string> m_inputs;
+};
+
+class StressTestCorpus : public Corpus {
+protected:
+    std::string generate(corpus::Generator& gen, std::size_t length) override {
+        return gen.stress_test(length);
+    }
+};
+
+class NestedParensCorpus : public Corpus {
+protected:
+    std::string generate(corpus::Generator& gen, std::size_t length) override {
+        return gen.nested_parens(length);
+    }
+};
+
+class PowerChainCorpus : public Corpus {
+protected:
+    std::string generate(corpus::Generator& gen, std::size_t length) override {
+        return gen.power_chain(length);
+    }
+};
+
+class InvalidCorpus : public Corpus {
+protected:
+    std::string generate(corpus::Generator& gen, std::size_t length) override {
+        return gen.invalid(length);
+    }
+};
+
+} // namespace
+
+BENCHMARK_DEFINE_F(StressTestCorpus, GetTokens)(benchmark::State& state) {
+    get_tokens(state);
+}
+BENCHMARK_REGISTER_F(StressTestCorpus, GetTokens)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(StressTestCorpus, Exec)(benchmark::State& state) {
+    exec(state);
+}
+BENCHMARK_REGISTER_F(StressTestCorpus, Exec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(StressTestCorpus, StreamExec)(benchmark::State& state) {
+    stream_exec(state);
+}
+BENCHMARK_REGISTER_F(StressTestCorpus, StreamExec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(StressTestCorpus, CompileExec)(benchmark::State& state) {
+    compile_exec(state);
+}
+BENCHMARK_REGISTER_F(StressTestCorpus, CompileExec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(StressTestCorpus, ProgramExec)(benchmark::State& state) {
+    program_exec(state);
+}
+BENCHMARK_REGISTER_F(StressTestCorpus, ProgramExec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(NestedParensCorpus, GetTokens)(benchmark::State& state) {
+    get_tokens(state);
+}
+BENCHMARK_REGISTER_F(NestedParensCorpus, GetTokens)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(NestedParensCorpus, Exec)(benchmark::State& state) {
+    exec(state);
+}
+BENCHMARK_REGISTER_F(NestedParensCorpus, Exec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(NestedParensCorpus, CompileExec)(benchmark::State& state) {
+    compile_exec(state);
+}
+BENCHMARK_REGISTER_F(NestedParensCorpus, CompileExec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(NestedParensCorpus, ProgramExec)(benchmark::State& state) {
+    program_exec(state);
+}
+BENCHMARK_REGISTER_F(NestedParensCorpus, ProgramExec)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(PowerChainCorpus, GetTokens)(benchmark::State& state) {
+    get_tokens(state);
+}
+BENCHMARK_REGISTER_F(PowerChainCorpus, GetTokens)->RangeMultiplier(10)->Range(10, 1000);
+
+BENCHMARK_DEFINE_F(PowerChainCorpus, Exec)(benchmark::State& state) {
+    exec(state);
+}
+BENCHMARK_REGISTER_F(PowerChainCorpus, Exec)->RangeMultiplier(10)->Range(10, 1000);
+
+// Lexer::get_tokens and Parser::exec throw on invalid input.
+BENCHMARK_DEFINE_F(InvalidCorpus, TryExec)(benchmark::State& state) {
+    try_exec(state);
+}
+BENCHMARK_REGISTER_F(InvalidCorpus, TryExec)->RangeMultiplier(10)->Range(10, 1000);
@@ -0,0 +1,197 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <main/server.hpp>
+#include <main/settings.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Connection churn: every client connects, evaluates a single expression and
+// disconnects, like `math-client -c` does.
+// The number of items processed per second is the number of connections.
+
+// Connections: that many clients stay connected, and each of them sends a
+// request and waits for the reply.
+// Build with -D IO_URING=ON to compare io_uring against epoll.
+
+// Round trip: a single client sends a request and waits for the reply, over
+// either TCP (loopback) or a UNIX domain socket.
+
+namespace {
+
+constexpr unsigned short PORT = 16667;
+constexpr std::string_view REQUEST{"2 * 2\n"};
+
+std::string get_unix_socket() {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    static const auto path =
+        (boost::filesystem::temp_directory_path() / "math-server-benchmarks.sock").string();
+    return path;
+#else
+    return {};
+#endif
+}
+
+class RunningServer {
+public:
+    RunningServer() : m_server{make_settings()}, m_thread{[this]() { m_server.run(); }} {}
+
+    ~RunningServer() {
+        m_server.stop();
+        m_thread.join();
+    }
+
+private:
+    static constexpr std::size_t NUMOF_THREADS = 2;
+
+    // The defaults, except that there's no cache and no compute threads.
+    static math::server::Settings make_settings() {
+        math::server::Settings settings;
+        settings.m_port = PORT;
+        settings.m_threads = NUMOF_THREADS;
+        settings.m_cache_size = 0;
+        settings.m_compute_threads = 0;
+        settings.m_unix_socket = get_unix_socket();
+        return settings;
+    }
+
+    math::server::Server m_server;
+    std::thread m_thread;
+};
+
+RunningServer& get_server() {
+    static RunningServer server;
+    return server;
+}
+
+const boost::asio::ip::tcp::endpoint& get_endpoint() {
+    static const boost::asio::ip::tcp::endpoint endpoint{boost::asio::ip::address_v4::loopback(),
+                                                         PORT};
+    return endpoint;
+}
+
+// Both ends of every connection live in this process.
+bool enough_files(std::size_t numof_connections) {
+#ifndef _WIN32
+    static constexpr rlim_t RESERVED = 64;
+    const auto needed = 2 * static_cast<rlim_t>(numof_connections) + RESERVED;
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+        return false;
+    }
+    if (limit.rlim_cur >= needed) {
+        return true;
+    }
+    if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < needed) {
+        return false;
+    }
+    limit.rlim_cur = needed;
+    return setrlimit(RLIMIT_NOFILE, &limit) == 0;
+#else
+    (void)numof_connections;
+    return true;
+#endif
+}
+
+void connect_once(boost::asio::io_context& io_context, boost::asio::streambuf& reply) {
+    boost::asio::ip::tcp::socket socket{io_context};
+    socket.connect(get_endpoint());
+    boost::asio::write(socket, boost::asio::buffer(REQUEST.data(), REQUEST.size()));
+    // The server closes the connection first, so that the client doesn't run
+    // out of ports because of TIME_WAIT.
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+    boost::system::error_code ec;
+    boost::asio::read(socket, reply, ec);
+    reply.consume(reply.size());
+}
+
+void Churn(benchmark::State& state) {
+    get_server();
+    boost::asio::io_context io_context;
+    boost::asio::streambuf reply;
+    for (auto _ : state) {
+        connect_once(io_context, reply);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void Connections(benchmark::State& state) {
+    const auto numof_connections = static_cast<std::size_t>(state.range(0));
+    if (!enough_files(numof_connections)) {
+        state.SkipWithError("not enough file descriptors");
+        return;
+    }
+    get_server();
+    boost::asio::io_context io_context;
+    std::vector<boost::asio::ip::tcp::socket> sockets;
+    sockets.reserve(numof_connections);
+    for (std::size_t i = 0; i < numof_connections; ++i) {
+        sockets.emplace_back(io_context).connect(get_endpoint());
+    }
+
+    boost::asio::streambuf reply;
+    for (auto _ : state) {
+        for (auto& socket : sockets) {
+            boost::asio::write(socket, boost::asio::buffer(REQUEST.data(), REQUEST.size()));
+        }
+        for (auto& socket : sockets) {
+            boost::asio::read_until(socket, reply, '\n');
+            reply.consume(reply.size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numof_connections);
+}
+
+template <typename Socket>
+void round_trip(benchmark::State& state, Socket& socket) {
+    boost::asio::streambuf reply;
+    for (auto _ : state) {
+        boost::asio::write(socket, boost::asio::buffer(REQUEST.data(), REQUEST.size()));
+        boost::asio::read_until(socket, reply, '\n');
+        reply.consume(reply.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void RoundTripTcp(benchmark::State& state) {
+    get_server();
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::socket socket{io_context};
+    socket.connect(get_endpoint());
+    round_trip(state, socket);
+}
+
+void RoundTripUnix(benchmark::State& state) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    get_server();
+    boost::asio::io_context io_context;
+    boost::asio::local::stream_protocol::socket socket{io_context};
+    socket.connect(boost::asio::local::stream_protocol::endpoint{get_unix_socket()});
+    round_trip(state, socket);
+#else
+    state.SkipWithError("UNIX domain sockets are not supported");
+#endif
+}
+
+} // namespace
+
+BENCHMARK(Churn)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(Connections)->Arg(1)->Arg(100)->Arg(10000)->UseRealTime();
+BENCHMARK(RoundTripTcp)->UseRealTime();
+BENCHMARK(RoundTripUnix)->UseRealTime();
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// The replacements live in a file of their own, so that the compiler doesn't
+// try to match them against the new/delete expressions it inlines them into.
+
+namespace allocations {
+namespace {
+
+std::atomic<std::size_t> count{0};
+std::atomic<std::size_t> max_size{0};
+
+void update_max_size(std::size_t size) {
+    auto current = max_size.load();
+    while (size > current && !max_size.compare_exchange_weak(current, size)) {
+    }
+}
+
+} // namespace
+
+std::size_t get_count() {
+    return count.load();
+}
+
+std::size_t get_max_size() {
+    return max_size.load();
+}
+
+void reset_max_size() {
+    max_size.store(0);
+}
+
+} // namespace allocations
+
+void* operator new(std::size_t size) {
+    ++allocations::count;
+    allocations::update_max_size(size);
+    if (const auto ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
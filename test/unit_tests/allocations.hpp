@@ -0,0 +1,20 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <cstddef>
+
+namespace allocations {
+
+// The global operator new is replaced to count every allocation in the
+// process (on any thread).
+std::size_t get_count();
+
+// The largest single allocation since the last reset.
+std::size_t get_max_size();
+void reset_max_size();
+
+} // namespace allocations
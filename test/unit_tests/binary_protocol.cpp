@@ -0,0 +1,259 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "test_server.hpp"
+
+#include <client/transport.hpp>
+#include <common/binary_protocol.hpp>
+
+#include <boost/test/data/monomorphic.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace bdata = boost::unit_test::data;
+namespace binary = math::server::binary;
+using binary::RequestHeader;
+using binary::Status;
+using test_server::Client;
+using test_server::RunningServer;
+
+namespace math::server::binary {
+
+std::ostream& operator<<(std::ostream& os, const RequestHeader& header) {
+    os << '(' << header.m_id << ", " << header.m_length << ')';
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, Status status) {
+    os << static_cast<unsigned>(status);
+    return os;
+}
+
+} // namespace math::server::binary
+
+namespace {
+
+const std::string MAGIC{static_cast<char>(binary::MAGIC)};
+
+std::string make_request(std::uint32_t id, const std::string_view& expression) {
+    std::string request;
+    binary::encode_header(request, {id, static_cast<std::uint32_t>(expression.length())});
+    request += expression;
+    return request;
+}
+
+std::uint32_t read_u32(Client& client) {
+    return binary::decode_u32(client.read(4).data());
+}
+
+Status read_status(Client& client) {
+    return static_cast<Status>(client.read(1)[0]);
+}
+
+double read_double(Client& client) {
+    return binary::decode_double(client.read(8).data());
+}
+
+std::string read_message(Client& client) {
+    return client.read(read_u32(client));
+}
+
+void check_result(Client& client, std::uint32_t id, double expected) {
+    BOOST_TEST(read_u32(client) == id);
+    BOOST_TEST_REQUIRE(read_status(client) == Status::RESULT);
+    BOOST_TEST(read_double(client) == expected);
+}
+
+void check_failure(Client& client, std::uint32_t id) {
+    BOOST_TEST(read_u32(client) == id);
+    BOOST_TEST_REQUIRE(read_status(client) == Status::FAILURE);
+    BOOST_TEST(!read_message(client).empty());
+}
+
+const std::vector<RequestHeader> headers{
+    {0, 0},
+    {1, 5},
+    {0x04030201, 0x08070605},
+    {std::numeric_limits<std::uint32_t>::max(), std::numeric_limits<std::uint32_t>::max()},
+};
+
+const std::vector<double> results{
+    0,
+    -1.5,
+    1e308,
+    std::numeric_limits<double>::denorm_min(),
+    std::numeric_limits<double>::infinity(),
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(binary_protocol_tests)
+
+BOOST_DATA_TEST_CASE(test_header_round_trip, bdata::make(headers), header) {
+    std::string encoded;
+    binary::encode_header(encoded, header);
+    BOOST_TEST_REQUIRE(encoded.size() == binary::REQUEST_HEADER_SIZE);
+    const auto decoded = binary::decode_header(encoded.data());
+    BOOST_TEST(decoded.m_id == header.m_id);
+    BOOST_TEST(decoded.m_length == header.m_length);
+}
+
+BOOST_AUTO_TEST_CASE(test_header_is_little_endian) {
+    std::string encoded;
+    binary::encode_header(encoded, {0x04030201, 0x08070605});
+    BOOST_TEST(encoded == std::string_view("\x01\x02\x03\x04\x05\x06\x07\x08"));
+}
+
+BOOST_DATA_TEST_CASE(test_result_round_trip, bdata::make(results), result) {
+    std::string encoded;
+    binary::encode_result(encoded, result);
+    BOOST_TEST_REQUIRE(encoded.size() == 1 + sizeof(double));
+    BOOST_TEST(static_cast<Status>(encoded[0]) == Status::RESULT);
+    BOOST_TEST(binary::decode_double(encoded.data() + 1) == result);
+}
+
+BOOST_AUTO_TEST_CASE(test_error_encoding) {
+    std::string encoded;
+    binary::encode_error(encoded, "oops");
+    BOOST_TEST(static_cast<Status>(encoded[0]) == Status::FAILURE);
+    BOOST_TEST(binary::decode_u32(encoded.data() + 1) == 4);
+    BOOST_TEST(encoded.substr(5) == "oops");
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_request) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    client.send(MAGIC + make_request(7, "2 * 2"));
+    check_result(client, 7, 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_text_request) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    // Only the very first byte switches the session to the binary protocol.
+    client.send("2 * 2\n" + MAGIC + "\n");
+    BOOST_TEST(client.read_line() == "4\r\n");
+    const auto reply = client.read_line();
+    BOOST_TEST(reply.size() > 2);
+    BOOST_TEST(reply.substr(reply.size() - 2) == "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_error) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    client.send(MAGIC + make_request(1, "2 *"));
+    check_failure(client, 1);
+
+    // The session goes on.
+    client.send(make_request(2, "1 + 2"));
+    check_result(client, 2, 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_pipelined_requests) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    client.send(MAGIC + make_request(3, "1") + make_request(2, "2 *") + make_request(1, "3"));
+    check_result(client, 3, 1);
+    check_failure(client, 2);
+    check_result(client, 1, 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_split_request) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    const auto request = make_request(5, "(1 + 2) * 3");
+    client.send(MAGIC + request.substr(0, 3));
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    client.send(request.substr(3, 7));
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    client.send(request.substr(10));
+    check_result(client, 5, 9);
+}
+
+BOOST_AUTO_TEST_CASE(test_truncated_request) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    // The request is cut short by the end of the connection, and ignored.
+    const auto request = make_request(1, "1 + 2");
+    client.send(MAGIC + request.substr(0, request.size() - 1));
+    client.shutdown_send();
+    BOOST_TEST(client.read_all().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_oversized_request) {
+    static constexpr std::size_t MAX_LINE_LENGTH = 4 * 1024;
+
+    auto settings = test_server::make_settings();
+    settings.m_max_line_length = MAX_LINE_LENGTH;
+    RunningServer server{settings};
+    Client client{server.get_port()};
+
+    // The header counts towards the limit.
+    const auto length =
+        static_cast<std::uint32_t>(MAX_LINE_LENGTH - binary::REQUEST_HEADER_SIZE + 1);
+    std::string request{MAGIC};
+    binary::encode_header(request, {9, length});
+    client.send(request);
+
+    // The request can't be skipped, so the connection is closed.
+    check_failure(client, 9);
+    BOOST_TEST(client.read_all().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_batch) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    // A single response with an item per expression, empty ones included.
+    client.send(MAGIC + make_request(4, "1;; 2 *;3"));
+    BOOST_TEST(read_u32(client) == 4);
+    BOOST_TEST_REQUIRE(read_status(client) == Status::BATCH);
+    BOOST_TEST_REQUIRE(read_u32(client) == 4);
+    BOOST_TEST_REQUIRE(read_status(client) == Status::RESULT);
+    BOOST_TEST(read_double(client) == 1);
+    BOOST_TEST_REQUIRE(read_status(client) == Status::FAILURE);
+    BOOST_TEST(!read_message(client).empty());
+    BOOST_TEST_REQUIRE(read_status(client) == Status::FAILURE);
+    BOOST_TEST(!read_message(client).empty());
+    BOOST_TEST_REQUIRE(read_status(client) == Status::RESULT);
+    BOOST_TEST(read_double(client) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_client_transport) {
+    RunningServer server;
+    const auto port = std::to_string(server.get_port());
+    math::client::BinaryNetworkTransport transport{"127.0.0.1", port};
+
+    std::vector<std::string> replies;
+    const auto on_reply = [&replies](const std::string& reply) { replies.emplace_back(reply); };
+    transport.send_query("2 * 2", on_reply);
+    transport.send_query("1 / 3", on_reply);
+    transport.send_query("1; 2 *; 3", on_reply);
+
+    BOOST_TEST_REQUIRE(replies.size() == 3);
+    BOOST_TEST(replies[0] == "4");
+    // Formatted the way the server would do it in text mode.
+    BOOST_TEST(replies[1] == "0.3333333333333333");
+    BOOST_TEST(replies[2].substr(0, 3) == "1; ");
+    BOOST_TEST(replies[2].substr(replies[2].size() - 3) == "; 3");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
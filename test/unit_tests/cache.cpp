@@ -0,0 +1,185 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <cache/reply_cache.hpp>
+#include <lexer/lexer.hpp>
+#include <lexer/token_buffer.hpp>
+
+#include <boost/test/data/monomorphic.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bdata = boost::unit_test::data;
+using math::server::Lexer;
+using math::server::ReplyCache;
+using math::server::lexer::TokenBuffer;
+
+namespace {
+namespace normalize {
+
+const std::vector<std::string_view> input{
+    "",
+    "   ",
+    " 1 + 2 ",
+    "\t( 1 +\t2 ) * -  3\r",
+    "1 2",
+    "1 .5",
+    "1. 5",
+    "1 e5",
+    "1e 5",
+    "1e +5",
+    "1e+ 5",
+    "1 e +5",
+    "1 + 5",
+    "1 +5e 5",
+    "x  y",
+    "2 x",
+    " x1 * _y ",
+};
+
+const std::vector<std::string_view> expected{
+    "",
+    "",
+    "1+2",
+    "(1+2)*-3",
+    "1 2",
+    "1 .5",
+    "1. 5",
+    "1 e5",
+    "1e 5",
+    "1e +5",
+    "1e+ 5",
+    "1 e +5",
+    "1+5",
+    "1+5e 5",
+    "x y",
+    "2 x",
+    "x1*_y",
+};
+
+} // namespace normalize
+
+std::string normalize_input(const std::string_view& input) {
+    std::string key;
+    ReplyCache::normalize(input, key);
+    return key;
+}
+
+bool same_tokens(const TokenBuffer& a, const TokenBuffer& b) {
+    if (a.size() != b.size() || a.numof_numbers() != b.numof_numbers()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a.get_type(i) != b.get_type(i)) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < a.numof_numbers(); ++i) {
+        if (a.get_number(i) != b.get_number(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool find(ReplyCache& cache, const std::string_view& key, std::string& reply) {
+    return cache.find(key, [&reply](const std::string_view& cached) { reply = cached; });
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(cache_tests)
+
+BOOST_DATA_TEST_CASE(test_normalize,
+                     bdata::make(normalize::input) ^ normalize::expected,
+                     input,
+                     expected) {
+    BOOST_TEST(normalize_input(input) == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_normalize_keeps_tokens, bdata::make(normalize::input), input) {
+    TokenBuffer expected, actual;
+    const auto expected_status = Lexer::try_tokenize_all(input, expected);
+    const auto key = normalize_input(input);
+    const auto actual_status = Lexer::try_tokenize_all(key, actual);
+    BOOST_TEST_REQUIRE(expected_status.has_value() == actual_status.has_value());
+    if (expected_status) {
+        BOOST_TEST(same_tokens(expected, actual));
+    } else {
+        BOOST_TEST(expected_status.error().get_msg() == actual_status.error().get_msg());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_hit_and_miss) {
+    ReplyCache cache{1024 * 1024};
+    std::string reply;
+    BOOST_TEST(!find(cache, "1+2", reply));
+    cache.insert("1+2", "3");
+    BOOST_TEST(find(cache, "1+2", reply));
+    BOOST_TEST(reply == "3");
+    BOOST_TEST(!find(cache, "1+3", reply));
+
+    const auto stats = cache.get_stats();
+    BOOST_TEST(stats.hits == 1);
+    BOOST_TEST(stats.misses == 2);
+    BOOST_TEST(stats.insertions == 1);
+    BOOST_TEST(stats.entries == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_byte_budget) {
+    // A single shard, so that every entry competes with every other one.
+    static constexpr std::size_t max_bytes = 4096;
+    ReplyCache cache{max_bytes, 1};
+    std::string reply;
+    for (int i = 0; i < 1000; ++i) {
+        const auto key = std::to_string(i) + "+0";
+        find(cache, key, reply);
+        cache.insert(key, std::to_string(i));
+    }
+    const auto stats = cache.get_stats();
+    BOOST_TEST(stats.bytes <= max_bytes);
+    BOOST_TEST(stats.entries > 0);
+    BOOST_TEST(stats.insertions + stats.rejections == 1000);
+    BOOST_TEST(stats.insertions - stats.evictions == stats.entries);
+}
+
+BOOST_AUTO_TEST_CASE(test_popular_entries_stay) {
+    static constexpr std::size_t max_bytes = 4096;
+    ReplyCache cache{max_bytes, 1};
+    std::string reply;
+
+    const std::string popular{"2*2"};
+    for (int i = 0; i < 5; ++i) {
+        find(cache, popular, reply);
+    }
+    cache.insert(popular, "4");
+
+    // A scan of one-off expressions.
+    for (int i = 0; i < 1000; ++i) {
+        const auto key = std::to_string(i) + "+0";
+        if (!find(cache, key, reply)) {
+            cache.insert(key, std::to_string(i));
+        }
+    }
+
+    BOOST_TEST(find(cache, popular, reply));
+    BOOST_TEST(reply == "4");
+    BOOST_TEST(cache.get_stats().rejections > 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_too_large) {
+    ReplyCache cache{1024, 1};
+    cache.insert(std::string(2048, '1'), "1");
+    std::string reply;
+    BOOST_TEST(!find(cache, std::string(2048, '1'), reply));
+    BOOST_TEST(cache.get_stats().rejections == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
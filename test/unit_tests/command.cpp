@@ -0,0 +1,186 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <command/error.hpp>
+#include <command/processor.hpp>
+#include <command/registry.hpp>
+#include <common/result.hpp>
+
+#include <boost/test/data/monomorphic.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bdata = boost::unit_test::data;
+using math::server::CommandProcessor;
+using math::server::ExpressionRegistry;
+
+namespace {
+
+std::string exec(CommandProcessor& processor, const std::string_view& input) {
+    const auto result = processor.exec(input);
+    if (!result) {
+        return math::server::command::to_string(result.error());
+    }
+    if (!result->has_value()) {
+        return "ok";
+    }
+    return std::to_string(**result);
+}
+
+namespace is_command {
+
+const std::vector<std::string_view> input{
+    "prepare f(x) = x",
+    "  execute f(1)",
+    "execute",
+    "1 + 2",
+    "prepared",
+    "x + 1",
+    "",
+};
+
+const std::vector<bool> expected{
+    true,
+    true,
+    true,
+    false,
+    false,
+    false,
+    false,
+};
+
+} // namespace is_command
+
+namespace invalid {
+
+const std::vector<std::string_view> input{
+    "prepare",
+    "prepare f",
+    "prepare f(x",
+    "prepare f(x,)",
+    "prepare f(x, x) = x",
+    "prepare f(x) x",
+    "prepare f(x) = y",
+    "prepare f(x) = x +",
+    "prepare f(x) = x & 1",
+    "execute g(1)",
+    "execute f",
+    "execute f(1",
+    "execute f(a)",
+    "execute f(1e)",
+    "execute f(1, 2)",
+    "execute f(1) + 1",
+    "execute f(0)",
+};
+
+const std::vector<std::string> error_msg{
+    "server error: command error: expected a name",
+    "server error: command error: expected '('",
+    "server error: command error: expected ',' or ')'",
+    "server error: command error: expected a parameter name: )",
+    "server error: command error: duplicate parameter: x",
+    "server error: command error: expected '=': x",
+    "server error: parser error: unknown variable: y",
+    "server error: parser error: expected '-', '+', '(' or a number",
+    "server error: lexer error: invalid input at: & 1",
+    "server error: command error: unknown expression: g",
+    "server error: command error: expected '('",
+    "server error: command error: expected ',' or ')'",
+    "server error: command error: expected a number: a)",
+    "server error: lexer error: exponent has no digits: 1e",
+    "server error: command error: wrong number of arguments: f",
+    "server error: command error: unexpected input after ')': + 1",
+    "server error: parser error: division by zero",
+};
+
+} // namespace invalid
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(command_tests)
+
+BOOST_DATA_TEST_CASE(test_is_command,
+                     bdata::make(is_command::input) ^ is_command::expected,
+                     input,
+                     expected) {
+    BOOST_TEST(CommandProcessor::is_command(input) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_reject_long_line) {
+    using math::server::command::to_string;
+    BOOST_TEST(to_string(CommandProcessor::reject_long_line(" execute f(1, 2, 3")) ==
+               "server error: command error: command is too long");
+    // The same as what Parser would say.
+    BOOST_TEST(to_string(CommandProcessor::reject_long_line("x + 1 + 1")) ==
+               "server error: parser error: unknown variable: x");
+}
+
+BOOST_AUTO_TEST_CASE(test_prepare_execute) {
+    CommandProcessor processor;
+    BOOST_TEST(exec(processor, "prepare f(x, y) = x * (y - 1) ^ x") == "ok");
+    BOOST_TEST(exec(processor, "execute f(2, 4)") == std::to_string(18.));
+    BOOST_TEST(exec(processor, " execute f ( -1 , +3 ) ") == std::to_string(-.5));
+    BOOST_TEST(exec(processor, "prepare pi() = 3.14159") == "ok");
+    BOOST_TEST(exec(processor, "execute pi()") == std::to_string(3.14159));
+    // Redefinition:
+    BOOST_TEST(exec(processor, "prepare f(x) = -x") == "ok");
+    BOOST_TEST(exec(processor, "execute f(1e3)") == std::to_string(-1000.));
+}
+
+BOOST_DATA_TEST_CASE(test_invalid,
+                     bdata::make(invalid::input) ^ invalid::error_msg,
+                     input,
+                     error_msg) {
+    CommandProcessor processor;
+    BOOST_TEST_REQUIRE(exec(processor, "prepare f(x) = 1 / x") == "ok");
+    BOOST_TEST(exec(processor, input) == error_msg);
+}
+
+BOOST_AUTO_TEST_CASE(test_global) {
+    ExpressionRegistry global;
+    CommandProcessor a{&global}, b{&global};
+    BOOST_TEST(exec(a, "prepare global f(x) = x + 1") == "ok");
+    BOOST_TEST(exec(b, "execute f(1)") == std::to_string(2.));
+    // Session expressions shadow global ones:
+    BOOST_TEST(exec(b, "prepare f(x) = x + 2") == "ok");
+    BOOST_TEST(exec(b, "execute f(1)") == std::to_string(3.));
+    BOOST_TEST(exec(a, "execute f(1)") == std::to_string(2.));
+    // An expression called "global":
+    BOOST_TEST(exec(a, "prepare global(x) = x") == "ok");
+    BOOST_TEST(exec(b, "execute global(1)") ==
+               "server error: command error: unknown expression: global");
+    BOOST_TEST(global.size() == 1);
+
+    CommandProcessor session_only;
+    BOOST_TEST(exec(session_only, "prepare global f(x) = x") ==
+               "server error: command error: global expressions are disabled");
+}
+
+BOOST_AUTO_TEST_CASE(test_reset) {
+    ExpressionRegistry global;
+    CommandProcessor processor{&global};
+    BOOST_TEST(exec(processor, "prepare f(x) = x") == "ok");
+    BOOST_TEST(exec(processor, "prepare global g(x) = x") == "ok");
+    processor.reset();
+    BOOST_TEST(exec(processor, "execute f(1)") ==
+               "server error: command error: unknown expression: f");
+    // Global expressions are not the session's to forget:
+    BOOST_TEST(exec(processor, "execute g(1)") == std::to_string(1.));
+}
+
+BOOST_AUTO_TEST_CASE(test_too_many) {
+    ExpressionRegistry global{2};
+    CommandProcessor processor{&global};
+    BOOST_TEST(exec(processor, "prepare global f(x) = x") == "ok");
+    BOOST_TEST(exec(processor, "prepare global g(x) = x") == "ok");
+    BOOST_TEST(exec(processor, "prepare global h(x) = x") ==
+               "server error: command error: too many prepared expressions");
+    BOOST_TEST(exec(processor, "prepare global g(x) = -x") == "ok");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
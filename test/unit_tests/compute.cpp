@@ -0,0 +1,250 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <common/error.hpp>
+#include <common/result.hpp>
+#include <compute/parallel_parser.hpp>
+#include <compute/worker_pool.hpp>
+#include <parser/error.hpp>
+#include <parser/parser.hpp>
+
+#include <boost/test/data/monomorphic.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bdata = boost::unit_test::data;
+using math::server::ParallelParser;
+using math::server::Parser;
+using math::server::Result;
+using math::server::WorkerPool;
+
+namespace {
+
+constexpr std::size_t NUMOF_TERMS = 20000;
+// Small enough for the inputs above to be split.
+constexpr std::size_t THRESHOLD = 1024;
+
+// 0.1 - 0.2 * 3 + (0.4 / 5 - 6) ^ 2 - ...
+std::string long_expression(std::size_t numof_terms, bool integers) {
+    static const std::vector<std::string> fractional{"0.1", "0.2 * 3", "(0.4 / 5 - 6) ^ 2",
+                                                     "-0.7", "8.9 / -(1.3)"};
+    static const std::vector<std::string> whole{"1", "2 * 3", "(4 - 6) ^ 2", "-7", "8 * (2)"};
+    const auto& terms = integers ? whole : fractional;
+
+    std::string result;
+    for (std::size_t i = 0; i < numof_terms; ++i) {
+        if (i != 0) {
+            result += i % 3 == 0 ? " - " : " + ";
+        }
+        result += terms[i % terms.size()];
+    }
+    return result;
+}
+
+std::string to_string(const Result<double>& result) {
+    if (result) {
+        return std::to_string(*result);
+    }
+    return math::server::parser::to_string(result.error());
+}
+
+Result<double> exec_parallel(const std::string& input, std::size_t threads) {
+    WorkerPool pool{threads};
+    return ParallelParser{&pool, THRESHOLD}.try_exec(input);
+}
+
+namespace inexact {
+
+std::string with_ones(const std::string& first, const std::string& last) {
+    std::string result{first};
+    for (std::size_t i = 0; i < NUMOF_TERMS; ++i) {
+        result += " + 1";
+    }
+    return result + last;
+}
+
+const std::vector<std::string> input{
+    // Fractions:
+    long_expression(NUMOF_TERMS, false),
+    with_ones("1", " + 1 / 3"),
+    // The ones are lost when they're added to 1e17 one by one, but not when
+    // they're added up separately first:
+    with_ones("1e17", " - 1e17"),
+    with_ones("2 ^ 60", " - 2 ^ 60"),
+};
+
+} // namespace inexact
+
+namespace invalid {
+
+const std::vector<std::string> input{
+    long_expression(NUMOF_TERMS, false) + " + 1 / 0",
+    "1 / 0 + " + long_expression(NUMOF_TERMS, false),
+    long_expression(NUMOF_TERMS / 2, false) + " 2 + " + long_expression(NUMOF_TERMS / 2, false),
+    long_expression(NUMOF_TERMS / 2, false) + " + (2 + " + long_expression(NUMOF_TERMS / 2, false),
+    long_expression(NUMOF_TERMS / 2, false) + " + 2) + " + long_expression(NUMOF_TERMS / 2, false),
+    long_expression(NUMOF_TERMS / 2, false) + " + x + " + long_expression(NUMOF_TERMS / 2, false),
+    long_expression(NUMOF_TERMS, false) + " +",
+};
+
+} // namespace invalid
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(compute_tests)
+
+BOOST_DATA_TEST_CASE(test_parallel_for, bdata::make({0, 1, 4}), threads) {
+    WorkerPool pool{static_cast<std::size_t>(threads)};
+    static constexpr std::size_t n = 10000;
+    std::vector<std::atomic<int>> calls(n);
+    pool.parallel_for(n, [&calls](std::size_t i) { ++calls[i]; });
+    for (std::size_t i = 0; i < n; ++i) {
+        BOOST_TEST(calls[i] == 1);
+    }
+    pool.parallel_for(0, [](std::size_t) { throw std::runtime_error{"no calls expected"}; });
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_for_throws) {
+    WorkerPool pool{2};
+    std::atomic<std::size_t> calls{0};
+    const auto task = [&calls](std::size_t i) {
+        ++calls;
+        if (i == 7) {
+            throw std::runtime_error{"7"};
+        }
+    };
+    BOOST_CHECK_THROW(pool.parallel_for(100, task), std::runtime_error);
+    // The other calls still happen.
+    BOOST_TEST(calls == 100);
+}
+
+BOOST_DATA_TEST_CASE(test_post, bdata::make({1, 4}), threads) {
+    static constexpr std::size_t n = 1000;
+    std::vector<std::atomic<int>> calls(n);
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::size_t done = 0;
+    // The workers are joined before the above are destroyed.
+    WorkerPool pool{static_cast<std::size_t>(threads)};
+    for (std::size_t i = 0; i < n; ++i) {
+        pool.post([&, i]() {
+            ++calls[i];
+            std::lock_guard<std::mutex> lck{mtx};
+            if (++done == n) {
+                cv.notify_all();
+            }
+        });
+    }
+    std::unique_lock<std::mutex> lck{mtx};
+    cv.wait(lck, [&done]() { return done == n; });
+    for (std::size_t i = 0; i < n; ++i) {
+        BOOST_TEST(calls[i] == 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_post_without_workers) {
+    WorkerPool pool{0};
+    BOOST_CHECK_THROW(pool.post([]() {}), math::server::Error);
+}
+
+BOOST_AUTO_TEST_CASE(test_nested_parallel_for) {
+    // Every worker waits for its own parallel_for, the helpers of which are
+    // stolen by the others (or done by the worker itself).
+    static constexpr std::size_t numof_threads = 4;
+    WorkerPool pool{numof_threads};
+    static constexpr std::size_t n = 100;
+    std::vector<std::atomic<int>> calls(numof_threads * n);
+    pool.parallel_for(numof_threads, [&pool, &calls](std::size_t i) {
+        pool.parallel_for(n, [&calls, i](std::size_t j) { ++calls[i * n + j]; });
+    });
+    for (const auto& call : calls) {
+        BOOST_TEST(call == 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_exec_on_worker) {
+    // The way sessions offload long expressions.
+    std::promise<Result<double>> promise;
+    WorkerPool pool{2};
+    ParallelParser parser{&pool, THRESHOLD};
+    const auto input = long_expression(NUMOF_TERMS, false);
+    const auto expected = exec_parallel(input, 2);
+    BOOST_TEST_REQUIRE(expected.has_value());
+
+    pool.post([&]() { promise.set_value(parser.try_exec(input)); });
+    const auto actual = promise.get_future().get();
+    BOOST_TEST_REQUIRE(actual.has_value());
+    BOOST_TEST(*actual == *expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_short_is_serial) {
+    WorkerPool pool{2};
+    ParallelParser parser{&pool, THRESHOLD};
+    for (const auto input : {"1 + 2", "0.1 + 0.2 + 0.3", "-2 ^ 2 - 3", "1 / 0 + 2"}) {
+        BOOST_TEST(to_string(parser.try_exec(input)) == to_string(Parser{input}.try_exec()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_deterministic) {
+    const auto input = long_expression(NUMOF_TERMS, false);
+    const auto expected = exec_parallel(input, 0);
+    BOOST_TEST_REQUIRE(expected.has_value());
+    for (const std::size_t threads : {1, 2, 4, 8}) {
+        for (int i = 0; i < 5; ++i) {
+            const auto actual = exec_parallel(input, threads);
+            BOOST_TEST_REQUIRE(actual.has_value());
+            // Bit-identical, not just close.
+            BOOST_TEST(std::signbit(*actual) == std::signbit(*expected));
+            BOOST_TEST(*actual == *expected);
+        }
+    }
+
+    BOOST_TEST(*expected == Parser{input}.exec());
+}
+
+BOOST_AUTO_TEST_CASE(test_integers_are_exact) {
+    const auto input = long_expression(NUMOF_TERMS, true);
+    const auto expected = Parser{input}.exec();
+    WorkerPool pool{4};
+    ParallelParser parser{&pool, THRESHOLD};
+    BOOST_TEST(*parser.try_exec(input) == expected);
+    BOOST_TEST(parser.was_parallel());
+}
+
+BOOST_DATA_TEST_CASE(test_inexact_is_serial, bdata::make(inexact::input), input) {
+    // Adding the terms up in a different order would change the result.
+    const auto expected = Parser{input}.exec();
+    WorkerPool pool{4};
+    ParallelParser parser{&pool, THRESHOLD};
+    BOOST_TEST(*parser.try_exec(input) == expected);
+    BOOST_TEST(!parser.was_parallel());
+}
+
+BOOST_AUTO_TEST_CASE(test_disabled) {
+    const auto input = long_expression(NUMOF_TERMS, false);
+    const auto expected = Parser{input}.exec();
+    WorkerPool pool{4};
+    ParallelParser disabled{&pool, 0};
+    BOOST_TEST(*disabled.try_exec(input) == expected);
+    ParallelParser no_pool;
+    BOOST_TEST(*no_pool.try_exec(input) == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_errors_agree, bdata::make(invalid::input), input) {
+    const auto expected = Parser{input}.try_exec();
+    BOOST_TEST_REQUIRE(!expected.has_value());
+    BOOST_TEST(to_string(exec_parallel(input, 4)) == to_string(expected));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <common/format.hpp>
+
+#include <boost/test/data/monomorphic.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace bdata = boost::unit_test::data;
+namespace format = math::server::format;
+
+namespace {
+namespace number::shortest {
+
+const std::vector<double> input{
+    0,
+    -0.,
+    1,
+    -3,
+    0.1,
+    0.1 + 0.2,
+    1. / 3,
+    1e21,
+    1.5e-7,
+    12345678901.,
+    std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::lowest(),
+    std::numeric_limits<double>::denorm_min(),
+    std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity(),
+};
+
+const std::vector<std::string> expected{
+    "0",
+    "-0",
+    "1",
+    "-3",
+    "0.1",
+    "0.30000000000000004",
+    "0.3333333333333333",
+    "1e+21",
+    "1.5e-07",
+    "12345678901",
+    "1.7976931348623157e+308",
+    "-1.7976931348623157e+308",
+    "5e-324",
+    "inf",
+    "-inf",
+};
+
+} // namespace number::shortest
+
+namespace number::precision {
+
+const std::vector<double> input{
+    0.1,
+    1. / 3,
+    1e21,
+    12345678901.,
+};
+
+const std::vector<unsigned> precision{
+    17,
+    6,
+    3,
+    3,
+};
+
+const std::vector<std::string> expected{
+    "0.10000000000000001",
+    "0.333333",
+    "1e+21",
+    "1.23e+10",
+};
+
+} // namespace number::precision
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(format_tests)
+
+BOOST_DATA_TEST_CASE(test_number_shortest,
+                     bdata::make(number::shortest::input) ^ number::shortest::expected,
+                     input,
+                     expected) {
+    BOOST_TEST(format::number(input) == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_number_precision,
+                     bdata::make(number::precision::input) ^ number::precision::precision ^
+                         number::precision::expected,
+                     input,
+                     precision,
+                     expected) {
+    BOOST_TEST(format::number(input, precision) == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_number_round_trips, bdata::make(number::shortest::input), input) {
+    BOOST_TEST(std::strtod(format::number(input).c_str(), nullptr) == input);
+}
+
+BOOST_AUTO_TEST_CASE(test_number_max_length) {
+    // The longest possible output must fit.
+    const auto lowest = std::numeric_limits<double>::lowest();
+    const auto denorm = -std::numeric_limits<double>::denorm_min();
+    for (const auto value : {lowest, denorm, -1.2345678901234567e-308}) {
+        BOOST_TEST(format::number(value, format::MAX_PRECISION).length() <=
+                   format::MAX_NUMBER_LENGTH);
+        BOOST_TEST(format::number(value).length() <= format::MAX_NUMBER_LENGTH);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
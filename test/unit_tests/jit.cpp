@@ -0,0 +1,181 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include <common/result.hpp>
+#include <jit/assembler.hpp>
+#include <jit/hot_program.hpp>
+#include <jit/native_program.hpp>
+#include <lexer/token_type.hpp>
+#include <parser/compiler.hpp>
+#include <parser/error.hpp>
+#include <parser/operator.hpp>
+#include <parser/program.hpp>
+
+#include <boost/test/data/monomorphic.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace bdata = boost::unit_test::data;
+using math::server::Compiler;
+using math::server::HotProgram;
+using math::server::NativeProgram;
+using math::server::Program;
+using math::server::Result;
+using Type = math::server::lexer::token::Type;
+
+namespace {
+
+using Code = std::vector<std::uint8_t>;
+
+std::uint64_t to_bits(double x) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(x));
+    return bits;
+}
+
+std::string to_string(const Result<double>& result) {
+    if (result) {
+        return std::to_string(to_bits(*result));
+    }
+    return math::server::parser::to_string(result.error());
+}
+
+Program compile(const std::string& input, const Compiler::Params& params = {}) {
+    Program program;
+    Compiler compiler;
+    const auto status = compiler.compile(input, params, program);
+    BOOST_TEST_REQUIRE(status.has_value());
+    return program;
+}
+
+const std::vector<Type> operators{Type::PLUS, Type::MINUS, Type::ASTERISK, Type::SLASH,
+                                  Type::CARET};
+
+const std::vector<std::string> operator_names{"+", "-", "*", "/", "^"};
+
+const std::vector<double> operands{
+    0.,
+    -0.,
+    1.,
+    -1.,
+    0.1,
+    -2.5,
+    3.,
+    1e308,
+    -1e-308,
+    std::numeric_limits<double>::denorm_min(),
+    std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::quiet_NaN(),
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(jit_tests)
+
+BOOST_AUTO_TEST_CASE(test_encoding) {
+    using math::server::jit::Assembler;
+    using math::server::jit::Reg;
+
+    Assembler a;
+    a.movsd(2, Reg::RBX, 8);
+    a.movsd(Reg::RSP, 16, 14);
+    a.addsd(13, 14);
+    a.push(Reg::R14);
+    a.movq(15, Reg::RAX);
+    a.call(Reg::RAX);
+    const Code expected{
+        // movsd xmm2, [rbx + 8]
+        0xf2, 0x0f, 0x10, 0x93, 0x08, 0x00, 0x00, 0x00,
+        // movsd [rsp + 16], xmm14
+        0xf2, 0x44, 0x0f, 0x11, 0xb4, 0x24, 0x10, 0x00, 0x00, 0x00,
+        // addsd xmm13, xmm14
+        0xf2, 0x45, 0x0f, 0x58, 0xee,
+        // push r14
+        0x41, 0x56,
+        // movq xmm15, rax
+        0x66, 0x4c, 0x0f, 0x6e, 0xf8,
+        // call rax
+        0xff, 0xd0,
+    };
+    BOOST_TEST(a.get_code() == expected, boost::test_tools::per_element());
+}
+
+BOOST_DATA_TEST_CASE(test_bit_identical,
+                     bdata::make(operators) ^ operator_names,
+                     type,
+                     name) {
+    if (!NativeProgram::is_supported()) {
+        return;
+    }
+    const auto native = NativeProgram::compile(compile("x " + name + " y", {"x", "y"}));
+    BOOST_TEST_REQUIRE(native.get() != nullptr);
+
+    const auto op = math::server::parser::BinaryOp::from_type(type);
+    for (const auto x : operands) {
+        for (const auto y : operands) {
+            const auto expected = op.exec(x, y);
+            const auto actual = native->exec({x, y});
+            BOOST_TEST(to_string(actual) == to_string(expected), x << ' ' << name << ' ' << y);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_agrees_with_interpreter) {
+    if (!NativeProgram::is_supported()) {
+        return;
+    }
+    // Deep enough for ^ to spill some of the stack slots.
+    const auto program =
+        compile("a - (b * (c / (a + (b - (c ^ -(a ^ b ^ 0.5))))) + 1.5) / -c", {"a", "b", "c"});
+    const auto native = NativeProgram::compile(program);
+    BOOST_TEST_REQUIRE(native.get() != nullptr);
+
+    std::vector<double> stack;
+    for (const auto a : operands) {
+        for (const auto b : operands) {
+            for (const auto c : {0., -3., 0.7}) {
+                const std::vector<double> args{a, b, c};
+                BOOST_TEST(to_string(native->exec(args)) == to_string(program.exec(args, stack)));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_too_deep) {
+    std::string input;
+    for (std::size_t i = 0; i <= NativeProgram::MAX_DEPTH; ++i) {
+        input += "(1 + ";
+    }
+    input += "1" + std::string(NativeProgram::MAX_DEPTH + 1, ')');
+    const auto program = compile(input);
+    BOOST_TEST(program.get_max_depth() > NativeProgram::MAX_DEPTH);
+    BOOST_TEST(NativeProgram::compile(program).get() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_hot_program) {
+    HotProgram hot{3};
+    hot.get_program() = compile("x / 2", {"x"});
+    std::vector<double> stack;
+    for (int i = 0; i < 5; ++i) {
+        BOOST_TEST(hot.is_native() == (NativeProgram::is_supported() && i >= 3));
+        BOOST_TEST(*hot.exec({double(i)}, stack) == i / 2.);
+    }
+
+    HotProgram cold{0};
+    cold.get_program() = compile("1 / x", {"x"});
+    for (int i = 0; i < 5; ++i) {
+        BOOST_TEST(!cold.exec({0}, stack).has_value());
+    }
+    BOOST_TEST(!cold.is_native());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
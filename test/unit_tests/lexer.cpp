@@ -3,21 +3,29 @@
 // For details, see https://github.com/egor-tensin/math-server.
 // Distributed under the MIT License.
 
+#include <lexer/details/classify.hpp>
 #include <lexer/details/parse.hpp>
 #include <lexer/error.hpp>
 #include <lexer/lexer.hpp>
 #include <lexer/token.hpp>
+#include <lexer/token_buffer.hpp>
 #include <lexer/token_type.hpp>
 
 #include <boost/test/data/monomorphic.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <cstddef>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 namespace bdata = boost::unit_test::data;
 using math::server::Lexer;
 using math::server::LexerError;
@@ -37,6 +45,39 @@ ostream& operator<<(ostream& os, const vector<Token>& tokens) {
 } // namespace std
 
 namespace {
+namespace parse_number {
+
+// clang-format off
+const std::vector<std::string_view> input{
+    "0",
+    "1.",
+    ".1",
+    ".1+1",
+    "1e3",
+    ".123e1",
+    "123e-1",
+    "123e+1",
+    "1.e6",
+    "2.3e-4",
+    "1.87E-18",
+    ".",
+    ".e3",
+    "e12",
+    "12e",
+    "12e+",
+    "12E-x",
+    "1.5.3",
+    "12345678901",
+    "0123",
+    "1e+10+1",
+    "9007199254740993",
+    "0.30000000000000004",
+    "123456789012345678901234567890.0987654321",
+};
+// clang-format on
+
+} // namespace parse_number
+
 namespace get_tokens::valid {
 
 // clang-format off
@@ -48,6 +89,7 @@ const std::vector<std::string_view> input{
     ".5^-1 ^ 4",
     "1+2 *  (3- 4e-2)",
     " 2 * (1 + 3 * (1 - -3)) ",
+    "x1 * (_y - e2) + 1e2",
 };
 // clang-format on
 
@@ -97,6 +139,17 @@ const std::vector<std::vector<Token>> expected{
         Token{Type::RIGHT_PAREN},
         Token{Type::RIGHT_PAREN},
     },
+    {
+        Token{"x1"},
+        Token{Type::ASTERISK},
+        Token{Type::LEFT_PAREN},
+        Token{"_y"},
+        Token{Type::MINUS},
+        Token{"e2"},
+        Token{Type::RIGHT_PAREN},
+        Token{Type::PLUS},
+        Token{1e2},
+    },
 };
 
 } // namespace get_tokens::valid
@@ -140,6 +193,29 @@ BOOST_AUTO_TEST_CASE(test_parse_number) {
     BOOST_CHECK_THROW(details::parse_number("12e"), LexerError);
 }
 
+BOOST_DATA_TEST_CASE(test_parse_number_impls_agree, bdata::make(parse_number::input), input) {
+    // The hand-written DFA must match exactly what the regexes match.
+    std::string_view boost_token, dfa_token;
+    std::optional<double> boost_result, dfa_result;
+    bool boost_threw = false, dfa_threw = false;
+    try {
+        boost_result = details::impl::boost_parse_number(input, boost_token);
+    } catch (const LexerError&) {
+        boost_threw = true;
+    }
+    try {
+        dfa_result = details::impl::dfa_parse_number(input, dfa_token);
+    } catch (const LexerError&) {
+        dfa_threw = true;
+    }
+    BOOST_TEST(boost_threw == dfa_threw);
+    BOOST_TEST(boost_result.has_value() == dfa_result.has_value());
+    if (boost_result.has_value() && dfa_result.has_value()) {
+        BOOST_TEST(*boost_result == *dfa_result);
+        BOOST_TEST(boost_token == dfa_token);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_parse_const_token) {
     BOOST_TEST(details::parse_const_token("+").value() == Type::PLUS);
     // parse_* functions only consume a single token:
@@ -149,6 +225,50 @@ BOOST_AUTO_TEST_CASE(test_parse_const_token) {
     BOOST_TEST(!details::parse_const_token("&+").has_value());
 }
 
+BOOST_AUTO_TEST_CASE(test_parse_const_token_impls_agree) {
+    for (int i = 0; i < 256; ++i) {
+        const std::string input(1, static_cast<char>(i));
+        BOOST_CHECK(details::impl::set_parse_const_token(input) ==
+                    details::impl::table_parse_const_token(input));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_char_map) {
+    using details::CharMap;
+    const CharMap map{" \t12 + (3.e4)\r\n&x_"};
+    BOOST_TEST(map.test(CharMap::Class::WHITESPACE, 0));
+    BOOST_TEST(map.test(CharMap::Class::WHITESPACE, 1));
+    BOOST_TEST(map.test(CharMap::Class::DIGIT, 2));
+    BOOST_TEST(map.test(CharMap::Class::OPERATOR, 5));
+    BOOST_TEST(!map.test(CharMap::Class::INVALID, 9));
+    BOOST_TEST(map.skip_whitespace(0) == 2);
+    BOOST_TEST(map.skip_whitespace(2) == 2);
+    BOOST_TEST(map.skip_whitespace(4) == 5);
+    BOOST_TEST(map.skip_whitespace(13) == 15);
+    BOOST_TEST(map.find_invalid() == 15);
+    BOOST_TEST(!map.test(CharMap::Class::INVALID, 16));
+    BOOST_TEST(!map.test(CharMap::Class::INVALID, 17));
+    BOOST_TEST(CharMap{"  "}.skip_whitespace(0) == 2);
+    BOOST_TEST(CharMap{"1 + 2"}.find_invalid() == CharMap::npos);
+}
+
+BOOST_AUTO_TEST_CASE(test_char_map_impls_agree) {
+    using details::CharMap;
+    // Every possible byte at every possible offset within a vector, followed
+    // by a tail which doesn't fill a whole word.
+    std::string input;
+    for (int i = 0; i < 256 * 33 + 17; ++i) {
+        input.push_back(static_cast<char>(i % 257));
+    }
+    const CharMap expected{input, CharMap::Impl::SCALAR};
+    for (const auto impl : {CharMap::Impl::SSE2, CharMap::Impl::AVX2}) {
+        if (!CharMap::is_supported(impl)) {
+            continue;
+        }
+        BOOST_CHECK(expected == (CharMap{input, impl}));
+    }
+}
+
 BOOST_DATA_TEST_CASE(test_get_tokens_valid,
                      bdata::make(get_tokens::valid::input) ^ get_tokens::valid::expected,
                      input,
@@ -159,6 +279,60 @@ BOOST_DATA_TEST_CASE(test_get_tokens_valid,
                                   expected.cend());
 }
 
+BOOST_DATA_TEST_CASE(test_tokenize_all,
+                     bdata::make(get_tokens::valid::input) ^ get_tokens::valid::expected,
+                     input,
+                     expected) {
+    math::server::lexer::TokenBuffer buffer;
+    Lexer{input}.tokenize_all(buffer);
+    std::vector<Token> actual;
+    for (std::size_t i = 0, n = 0, m = 0; i < buffer.size(); ++i) {
+        const auto type = buffer.get_type(i);
+        if (type == Type::NUMBER) {
+            actual.emplace_back(buffer.get_number(n++));
+        } else if (type == Type::IDENTIFIER) {
+            actual.emplace_back(buffer.get_identifier(m++));
+        } else {
+            actual.emplace_back(type);
+        }
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(actual.cbegin(), actual.cend(), expected.cbegin(),
+                                  expected.cend());
+}
+
+BOOST_AUTO_TEST_CASE(test_try_tokenize_all_reuses_buffer) {
+    // The classification of a longer input mustn't leak into a shorter one.
+    math::server::lexer::TokenBuffer buffer;
+    BOOST_TEST(!Lexer::try_tokenize_all(std::string(200, ' ') + "&", buffer).has_value());
+    BOOST_TEST(Lexer::try_tokenize_all("1 + 2", buffer).has_value());
+    BOOST_TEST(buffer.size() == 3);
+    BOOST_TEST(Lexer::try_tokenize_all("1" + std::string(200, ' ') + "+ 2", buffer).has_value());
+    BOOST_TEST(buffer.size() == 3);
+    const auto status = Lexer::try_tokenize_all("1 &", buffer);
+    BOOST_TEST_REQUIRE(!status.has_value());
+    BOOST_TEST(status.error().get_context() == "&");
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(test_try_tokenize_all_too_long) {
+    // The pages are never touched, so they don't take any memory.
+    const auto length = math::server::lexer::TokenBuffer::MAX_INPUT_LENGTH + 2;
+    const auto data =
+        ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    BOOST_TEST_REQUIRE(data != MAP_FAILED);
+    const std::string_view input{static_cast<const char*>(data), length};
+
+    math::server::lexer::TokenBuffer buffer;
+    auto status = math::server::success();
+    BOOST_CHECK_NO_THROW(status = Lexer::try_tokenize_all(input, buffer));
+    BOOST_TEST(!status.has_value());
+    BOOST_TEST(status.error().get_message() == "input is too long");
+    BOOST_TEST(buffer.empty());
+
+    ::munmap(data, length);
+}
+#endif
+
 BOOST_DATA_TEST_CASE(test_get_tokens_invalid,
                      bdata::make(get_tokens::invalid::input) ^ get_tokens::invalid::error_msg,
                      input,
@@ -3,20 +3,34 @@
 // For details, see https://github.com/egor-tensin/math-server.
 // Distributed under the MIT License.
 
+#include <common/result.hpp>
+#include <lexer/lexer.hpp>
+#include <lexer/token_buffer.hpp>
+#include <parser/compiler.hpp>
 #include <parser/error.hpp>
 #include <parser/parser.hpp>
+#include <parser/program.hpp>
+#include <parser/segments.hpp>
+#include <parser/stream_parser.hpp>
 
 #include <boost/test/data/monomorphic.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 #include <string_view>
 #include <vector>
 
 namespace bdata = boost::unit_test::data;
+using math::server::Compiler;
+using math::server::ErrorInfo;
 using math::server::Parser;
 using math::server::ParserError;
+using math::server::Program;
+using math::server::Result;
+using math::server::StreamParser;
 
 namespace {
 namespace exec::valid {
@@ -110,6 +124,96 @@ const std::vector<std::string> error_msg{
 };
 
 } // namespace exec::invalid
+
+namespace try_exec::invalid {
+
+const std::vector<std::string_view> input{
+    "1 / (3 - 3)",
+    "2 * 3e",
+    "2 * 3 & 4",
+    "2 * x + 1",
+    "2 * x & 1",
+};
+
+const std::vector<std::string> error_msg{
+    "server error: parser error: division by zero",
+    "server error: lexer error: exponent has no digits: 3e",
+    "server error: lexer error: invalid input at: & 4",
+    "server error: parser error: unknown variable: x",
+    "server error: lexer error: invalid input at: & 1",
+};
+
+} // namespace try_exec::invalid
+
+namespace stream {
+
+// Inputs where the order in which errors are detected matters.
+const std::vector<std::string_view> input{
+    "1 2",
+    "(1 2)",
+    "1 (2)",
+    "1 / 0 2",
+    "(1 / 0",
+    "1 / 0 + )",
+    "1 + )",
+    "2 ^ - - 2 * -3 ^ 2",
+    "-2 ^ -2 ^ -1",
+    " 12345678901 * -.5e-3 ",
+    "1e+ 2",
+    "1 + 2 e",
+    ". + 1",
+    "1 + 2 $ 1e",
+    "1 + 2 (3 & 4)",
+    "1 + 2 (3 4) ^ .",
+    "1 / 0 + abc",
+    "1 + abc def",
+    "1 abc",
+    "1ex + 2",
+    "1e5x + 2",
+    "E + x1 $",
+};
+
+std::string to_string(const Result<double>& result) {
+    if (result) {
+        return std::to_string(*result);
+    }
+    return math::server::parser::to_string(result.error());
+}
+
+std::string exec(const std::string_view& input) {
+    return to_string(Parser{input}.try_exec());
+}
+
+std::string exec_in_chunks(StreamParser& parser, const std::string_view& input, std::size_t size) {
+    parser.reset();
+    for (std::size_t pos = 0; pos < input.length(); pos += size) {
+        parser.feed(input.substr(pos, std::min(size, input.length() - pos)));
+    }
+    return to_string(parser.finish());
+}
+
+void check_stream(const std::string_view& input) {
+    const auto expected = exec(input);
+    StreamParser parser;
+    for (std::size_t size = 1; size <= input.length() + 1; ++size) {
+        BOOST_TEST(exec_in_chunks(parser, input, size) == expected, "chunk size: " << size);
+    }
+}
+
+} // namespace stream
+
+namespace compile {
+
+Result<double> compile_and_exec(const std::string_view& input) {
+    Compiler compiler;
+    Program program;
+    if (const auto status = compiler.compile(input, program); !status) {
+        return status.error();
+    }
+    return program.exec();
+}
+
+} // namespace compile
 } // namespace
 
 BOOST_AUTO_TEST_SUITE(parser_tests)
@@ -141,4 +245,188 @@ BOOST_DATA_TEST_CASE(test_exec_invalid,
     }
 }
 
+BOOST_DATA_TEST_CASE(test_try_exec_valid,
+                     bdata::make(exec::valid::input) ^ exec::valid::expected,
+                     input,
+                     expected) {
+    Parser parser{input};
+    const auto result = parser.try_exec();
+    BOOST_TEST_REQUIRE(result.has_value());
+    BOOST_TEST(*result == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_try_exec_invalid,
+                     (bdata::make(exec::invalid::input) ^ exec::invalid::error_msg) +
+                         (bdata::make(try_exec::invalid::input) ^ try_exec::invalid::error_msg),
+                     input,
+                     error_msg) {
+    Parser parser{input};
+    const auto result = parser.try_exec();
+    BOOST_TEST_REQUIRE(!result.has_value());
+    BOOST_TEST(error_msg == math::server::parser::to_string(result.error()));
+}
+
+BOOST_AUTO_TEST_CASE(test_error_context_is_truncated) {
+    const std::string input = "1 + " + std::string(1024 * 1024, '$');
+    Parser parser{input};
+    const auto result = parser.try_exec();
+    BOOST_TEST_REQUIRE(!result.has_value());
+    const std::string expected = "server error: lexer error: invalid input at: " +
+                                 std::string(ErrorInfo::MAX_CONTEXT_LENGTH, '$') + "...";
+    BOOST_TEST(expected == math::server::parser::to_string(result.error()));
+}
+
+BOOST_AUTO_TEST_CASE(test_max_depth) {
+    const std::string expected = "server error: parser error: expression is nested too deeply";
+    const auto exec = [](const std::string_view& input, std::size_t max_depth) {
+        return stream::to_string(Parser{input, max_depth}.try_exec());
+    };
+    BOOST_TEST(exec("((1 + 2))", 3) == std::to_string(3.));
+    BOOST_TEST(exec("(((1 + 2)))", 3) == expected);
+    // Right-associative operators wait on the stack, too.
+    BOOST_TEST(exec("1 ^ 2 ^ 3", 2) == std::to_string(1.));
+    BOOST_TEST(exec("1 ^ 2 ^ 3 ^ 4", 2) == expected);
+
+    StreamParser stream{3};
+    BOOST_TEST(stream::exec_in_chunks(stream, "(((1 + 2)))", 1) == expected);
+
+    Compiler compiler{3};
+    Program program;
+    const auto status = compiler.compile("-(-(-(1)))", program);
+    BOOST_TEST_REQUIRE(!status.has_value());
+    BOOST_TEST(math::server::parser::to_string(status.error()) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_deep_nesting) {
+    // Used to overflow the stack.
+    static constexpr std::size_t depth = 1000000;
+    const auto input = std::string(depth, '(') + "1" + std::string(depth, ')');
+    BOOST_TEST(stream::exec(input) ==
+               "server error: parser error: expression is nested too deeply");
+    Parser parser{input, depth};
+    BOOST_TEST(parser.exec() == 1);
+}
+
+BOOST_DATA_TEST_CASE(test_stream_agrees_valid, bdata::make(exec::valid::input), input) {
+    stream::check_stream(input);
+}
+
+BOOST_DATA_TEST_CASE(test_stream_agrees_invalid,
+                     bdata::make(exec::invalid::input) + try_exec::invalid::input + stream::input,
+                     input) {
+    stream::check_stream(input);
+}
+
+BOOST_AUTO_TEST_CASE(test_stream_error_context_is_truncated) {
+    const std::string input = "1 + " + std::string(1024 * 1024, '$');
+    StreamParser parser;
+    const auto expected = stream::exec(input);
+    BOOST_TEST(stream::exec_in_chunks(parser, input, 1000) == expected);
+    BOOST_TEST(stream::exec_in_chunks(parser, input, 1) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_stream_long_input) {
+    std::string input;
+    for (int i = 0; i < 100000; ++i) {
+        input += "(1 + 2 * 3) - 6 + ";
+    }
+    input += "0.5";
+    StreamParser parser;
+    BOOST_TEST(stream::exec_in_chunks(parser, input, 4096) == std::to_string(100000.5));
+}
+
+BOOST_AUTO_TEST_CASE(test_stream_number_too_long) {
+    const std::string number(math::server::StreamLexer::MAX_NUMBER_LENGTH + 1, '1');
+    StreamParser parser;
+    const std::string expected = "server error: lexer error: number is too long: " +
+                                 std::string(ErrorInfo::MAX_CONTEXT_LENGTH, '1') + "...";
+    BOOST_TEST(stream::exec_in_chunks(parser, "1 + " + number, 64) == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_compile_valid,
+                     bdata::make(exec::valid::input) ^ exec::valid::expected,
+                     input,
+                     expected) {
+    const auto result = compile::compile_and_exec(input);
+    BOOST_TEST_REQUIRE(result.has_value());
+    BOOST_TEST(*result == expected);
+}
+
+BOOST_DATA_TEST_CASE(test_compile_invalid,
+                     (bdata::make(exec::invalid::input) ^ exec::invalid::error_msg) +
+                         (bdata::make(try_exec::invalid::input) ^ try_exec::invalid::error_msg),
+                     input,
+                     error_msg) {
+    const auto result = compile::compile_and_exec(input);
+    BOOST_TEST_REQUIRE(!result.has_value());
+    BOOST_TEST(error_msg == math::server::parser::to_string(result.error()));
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_params) {
+    using Opcode = Program::Opcode;
+
+    Compiler compiler;
+    Program program;
+    const Compiler::Params params{"x", "y", "unused"};
+    BOOST_TEST_REQUIRE(compiler.compile("x * (y - 1) ^ x", params, program).has_value());
+
+    const std::vector<Opcode> code{Opcode::LOAD, Opcode::LOAD, Opcode::PUSH, Opcode::SUB,
+                                   Opcode::LOAD, Opcode::POW,  Opcode::MUL};
+    const std::vector<std::size_t> variables{0, 1, 0};
+    BOOST_CHECK(program.get_code() == code);
+    BOOST_TEST(program.get_variables() == variables, boost::test_tools::per_element());
+    BOOST_TEST(program.get_numof_args() == 2);
+
+    std::vector<double> stack;
+    BOOST_TEST(*program.exec({2, 4, 0}, stack) == 18);
+    BOOST_TEST(*program.exec({-1, 3, 0}, stack) == -.5);
+    BOOST_TEST(!program.exec({2}, stack).has_value());
+
+    const auto result = compiler.compile("x + z", params, program);
+    BOOST_TEST_REQUIRE(!result.has_value());
+    BOOST_TEST(math::server::parser::to_string(result.error()) ==
+               "server error: parser error: unknown variable: z");
+}
+
+BOOST_AUTO_TEST_CASE(test_compile_postfix) {
+    using Opcode = Program::Opcode;
+
+    Compiler compiler;
+    Program program;
+    BOOST_TEST_REQUIRE(compiler.compile("1 + 2 * -(3 - 4) ^ 5", program).has_value());
+
+    const std::vector<Opcode> code{Opcode::PUSH, Opcode::PUSH, Opcode::PUSH, Opcode::PUSH,
+                                   Opcode::SUB,  Opcode::PUSH, Opcode::POW,  Opcode::NEG,
+                                   Opcode::MUL,  Opcode::ADD};
+    const std::vector<double> constants{1, 2, 3, 4, 5};
+    BOOST_CHECK(program.get_code() == code);
+    BOOST_TEST(program.get_constants() == constants, boost::test_tools::per_element());
+    BOOST_TEST(program.get_max_depth() == 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_split) {
+    using math::server::lexer::TokenBuffer;
+
+    TokenBuffer tokens;
+    const auto status = math::server::Lexer::try_tokenize_all("1 - 2 * (3 + 4) + -x - 5", tokens);
+    BOOST_TEST_REQUIRE(status.has_value());
+    std::vector<TokenBuffer::Range> segments;
+    math::server::parser::split(tokens, 1, segments);
+
+    // 1, -2 * (3 + 4), + -x and -5.
+    const std::vector<std::size_t> begin{0, 1, 9, 12};
+    const std::vector<std::size_t> first_number{0, 1, 4, 4};
+    const std::vector<std::size_t> first_identifier{0, 0, 0, 1};
+    BOOST_TEST_REQUIRE(segments.size() == begin.size());
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        BOOST_TEST(segments[i].begin == begin[i]);
+        BOOST_TEST(segments[i].end == (i + 1 < begin.size() ? begin[i + 1] : tokens.size()));
+        BOOST_TEST(segments[i].first_number == first_number[i]);
+        BOOST_TEST(segments[i].first_identifier == first_identifier[i]);
+    }
+
+    math::server::parser::split(tokens, 4, segments);
+    BOOST_TEST(segments.size() == 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "test_server.hpp"
+
+#include <common/error.hpp>
+#include <main/server.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+using math::server::Error;
+using test_server::Client;
+using test_server::RunningServer;
+
+BOOST_AUTO_TEST_SUITE(server_tests)
+
+BOOST_AUTO_TEST_CASE(test_per_core) {
+    static constexpr std::size_t NUMOF_THREADS = 4;
+    static constexpr std::size_t NUMOF_CLIENTS = 4 * NUMOF_THREADS;
+    static constexpr std::size_t NUMOF_REQUESTS = 10;
+
+    auto settings = test_server::make_settings();
+    settings.m_threads = NUMOF_THREADS;
+    settings.m_per_core = true;
+    RunningServer server{settings};
+
+    // The kernel spreads the connections between the shards, which all
+    // listen on the same port.
+    std::vector<std::unique_ptr<Client>> clients;
+    for (std::size_t i = 0; i < NUMOF_CLIENTS; ++i) {
+        clients.emplace_back(std::make_unique<Client>(server.get_port()));
+    }
+    for (std::size_t i = 0; i < NUMOF_REQUESTS; ++i) {
+        for (const auto& client : clients) {
+            client->send("2 * 2\n");
+        }
+        for (const auto& client : clients) {
+            BOOST_TEST(client->read_line() == "4\r\n");
+        }
+    }
+}
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+namespace {
+
+class UnixSocketPath {
+public:
+    UnixSocketPath()
+        : m_path{(boost::filesystem::temp_directory_path() /
+                  boost::filesystem::unique_path("math-server-%%%%-%%%%.sock"))
+                     .string()} {}
+
+    ~UnixSocketPath() {
+        boost::system::error_code ec;
+        boost::filesystem::remove(m_path, ec);
+    }
+
+    const std::string& get() const { return m_path; }
+
+private:
+    const std::string m_path;
+};
+
+math::server::Settings make_settings(const std::string& unix_socket) {
+    auto settings = test_server::make_settings();
+    settings.m_unix_socket = unix_socket;
+    return settings;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_unix_socket) {
+    const UnixSocketPath path;
+    {
+        RunningServer server{make_settings(path.get())};
+        Client client{path.get()};
+        BOOST_TEST(client.round_trip("2 * 2\n", "4\r\n"));
+    }
+    BOOST_TEST(!boost::filesystem::exists(path.get()));
+}
+
+BOOST_AUTO_TEST_CASE(test_unix_socket_in_use) {
+    const UnixSocketPath path;
+    RunningServer server{make_settings(path.get())};
+
+    BOOST_CHECK_THROW(math::server::Server{make_settings(path.get())}, Error);
+
+    // The socket of the running server is left alone.
+    Client client{path.get()};
+    BOOST_TEST(client.round_trip("2 * 2\n", "4\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(test_stale_unix_socket) {
+    const UnixSocketPath path;
+    {
+        // Closing the acceptor leaves the socket file behind, like a killed
+        // server would.
+        boost::asio::io_context io_context;
+        boost::asio::local::stream_protocol::acceptor acceptor{io_context, path.get()};
+    }
+    BOOST_TEST_REQUIRE(boost::filesystem::exists(path.get()));
+
+    RunningServer server{make_settings(path.get())};
+    Client client{path.get()};
+    BOOST_TEST(client.round_trip("2 * 2\n", "4\r\n"));
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
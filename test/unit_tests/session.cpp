@@ -0,0 +1,351 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#include "allocations.hpp"
+#include "test_server.hpp"
+
+#include <main/session_context.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using test_server::Client;
+using test_server::RunningServer;
+
+namespace {
+
+constexpr std::string_view REQUEST{"2 * 2\n"};
+constexpr std::string_view REPLY{"4\r\n"};
+
+constexpr std::size_t NUMOF_REQUESTS = 1000;
+
+// Lines longer than this are streamed.
+constexpr std::size_t MAX_LINE_LENGTH = 4 * 1024;
+
+// Returns the number of allocations in the process during NUMOF_REQUESTS
+// requests, once the server has warmed up.
+std::size_t count_allocations(const math::server::Settings& settings) {
+    RunningServer server{settings};
+    Client client{server.get_port()};
+
+    // The session's buffers grow, Asio's caches fill up, etc.
+    for (std::size_t i = 0; i < NUMOF_REQUESTS; ++i) {
+        BOOST_TEST_REQUIRE(client.round_trip(REQUEST, REPLY));
+    }
+
+    std::size_t numof_bad_replies = 0;
+    const auto before = allocations::get_count();
+    for (std::size_t i = 0; i < NUMOF_REQUESTS; ++i) {
+        if (!client.round_trip(REQUEST, REPLY)) {
+            ++numof_bad_replies;
+        }
+    }
+    const auto after = allocations::get_count();
+
+    BOOST_TEST(numof_bad_replies == 0);
+    return after - before;
+}
+
+// Splits a reply to a batch into the replies to the individual items.
+std::vector<std::string> split_batch_reply(std::string reply) {
+    BOOST_TEST_REQUIRE(reply.size() >= 2);
+    BOOST_TEST_REQUIRE(reply.substr(reply.size() - 2) == "\r\n");
+    reply.resize(reply.size() - 2);
+
+    static constexpr std::string_view SEPARATOR{"; "};
+    std::vector<std::string> items;
+    std::size_t pos = 0;
+    for (auto sep = reply.find(SEPARATOR); sep != std::string::npos;
+         sep = reply.find(SEPARATOR, pos)) {
+        items.emplace_back(reply.substr(pos, sep - pos));
+        pos = sep + SEPARATOR.length();
+    }
+    items.emplace_back(reply.substr(pos));
+    return items;
+}
+
+std::string make_batch(std::size_t numof_items) {
+    std::string batch{"1"};
+    for (std::size_t i = 1; i < numof_items; ++i) {
+        batch += ";1";
+    }
+    return batch;
+}
+
+bool is_error(const std::string& reply) {
+    return reply.rfind("server error: ", 0) == 0;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(session_tests)
+
+BOOST_AUTO_TEST_CASE(test_no_allocations_per_request) {
+    BOOST_TEST(count_allocations(test_server::make_settings()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_no_allocations_per_request_per_core) {
+    auto settings = test_server::make_settings();
+    settings.m_threads = 2;
+    settings.m_per_core = true;
+    BOOST_TEST(count_allocations(settings) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_few_allocations_per_request_strand) {
+    auto settings = test_server::make_settings();
+    settings.m_threads = 2;
+    const auto numof_allocations = count_allocations(settings);
+    BOOST_TEST_MESSAGE("Allocations per " << NUMOF_REQUESTS << " requests: " << numof_allocations);
+    // When a session's strand still has work queued as a handler finishes,
+    // Asio reposts the strand using a per-thread cache of memory blocks,
+    // which misses now and then if several threads share the io_context.
+    BOOST_TEST(numof_allocations <= NUMOF_REQUESTS / 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_batch) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    client.send("1; 2 * 2;3\n");
+    BOOST_TEST(client.read_line() == "1; 4; 3\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(test_batch_error) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    // One bad item doesn't fail the rest of the batch.
+    client.send("1; 2 *; 3\n");
+    const auto items = split_batch_reply(client.read_line());
+    BOOST_TEST_REQUIRE(items.size() == 3);
+    BOOST_TEST(items[0] == "1");
+    BOOST_TEST(is_error(items[1]));
+    BOOST_TEST(items[2] == "3");
+}
+
+BOOST_AUTO_TEST_CASE(test_batch_empty_items) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    // Every item gets a reply, empty ones included.
+    client.send("1;;2\n1;2;\n");
+    {
+        const auto items = split_batch_reply(client.read_line());
+        BOOST_TEST_REQUIRE(items.size() == 3);
+        BOOST_TEST(items[0] == "1");
+        BOOST_TEST(is_error(items[1]));
+        BOOST_TEST(items[2] == "2");
+    }
+    {
+        const auto items = split_batch_reply(client.read_line());
+        BOOST_TEST_REQUIRE(items.size() == 3);
+        BOOST_TEST(items[0] == "1");
+        BOOST_TEST(items[1] == "2");
+        BOOST_TEST(is_error(items[2]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_pipelined_requests) {
+    static constexpr std::size_t NUMOF_REQUESTS = 100;
+
+    // The longer expressions are evaluated on the compute threads, and the
+    // shorter ones aren't.
+    auto settings = test_server::make_settings();
+    settings.m_compute_threads = 2;
+    settings.m_offload_threshold = 8;
+    RunningServer server{settings};
+    Client client{server.get_port()};
+
+    std::string requests;
+    for (std::size_t i = 0; i < NUMOF_REQUESTS; ++i) {
+        requests += std::to_string(i);
+        requests += i % 3 == 0 ? " + 0 + 0 + 0\n" : "\n";
+    }
+    client.send(requests);
+
+    for (std::size_t i = 0; i < NUMOF_REQUESTS; ++i) {
+        BOOST_TEST(client.read_line() == std::to_string(i) + "\r\n");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_last_line_without_lf) {
+    RunningServer server;
+    Client client{server.get_port()};
+
+    client.send("1\n2 * 2");
+    client.shutdown_send();
+    BOOST_TEST(client.read_all() == "1\r\n4\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(test_long_last_line_without_lf) {
+    auto settings = test_server::make_settings();
+    settings.m_max_line_length = MAX_LINE_LENGTH;
+    RunningServer server{settings};
+    Client client{server.get_port()};
+
+    // Evaluated as it arrives instead of being buffered.
+    std::string request{"1"};
+    while (request.size() <= MAX_LINE_LENGTH) {
+        request += " + 1";
+    }
+    const auto expected = std::to_string((request.size() - 1) / 4 + 1) + "\r\n";
+    client.send(request);
+    client.shutdown_send();
+    BOOST_TEST(client.read_all() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_long_command) {
+    auto settings = test_server::make_settings();
+    settings.m_max_line_length = MAX_LINE_LENGTH;
+    RunningServer server{settings};
+    Client client{server.get_port()};
+
+    // Commands aren't evaluated as they arrive, so they have to fit.
+    std::string request{"prepare f(x) = x"};
+    while (request.size() <= MAX_LINE_LENGTH) {
+        request += " + x";
+    }
+    client.send(request + "\n2 * 2\n");
+    BOOST_TEST(client.read_line() == "server error: command error: command is too long\r\n");
+    BOOST_TEST(client.read_line() == "4\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(test_long_junk) {
+    auto settings = test_server::make_settings();
+    settings.m_max_line_length = MAX_LINE_LENGTH;
+    RunningServer server{settings};
+    Client client{server.get_port()};
+
+    // Rejected without reading all of it, but the reply is the same as to a
+    // shorter line.
+    std::string request{"abc"};
+    client.send(request + "\n");
+    const auto expected = client.read_line();
+    BOOST_TEST(is_error(expected));
+    while (request.size() <= 16 * MAX_LINE_LENGTH) {
+        request += " abc";
+    }
+    client.send(request + "\n2 * 2\n");
+    BOOST_TEST(client.read_line() == expected);
+    BOOST_TEST(client.read_line() == "4\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(test_long_line_memory) {
+    using math::server::SessionContext;
+
+    std::string request{"1"};
+    while (request.size() <= 16 * SessionContext::DEFAULT_MAX_LINE_LENGTH) {
+        request += " + 1";
+    }
+    const auto expected = std::to_string((request.size() - 1) / 4 + 1) + "\r\n";
+    request += '\n';
+
+    RunningServer server;
+    Client client{server.get_port()};
+    BOOST_TEST_REQUIRE(client.round_trip("1\n", "1\r\n"));
+
+    // Only as much of the line is buffered as the limit allows (and then some,
+    // since the buffer grows geometrically).
+    allocations::reset_max_size();
+    client.send(request);
+    BOOST_TEST(client.read_line() == expected);
+    BOOST_TEST_MESSAGE("Largest allocation: " << allocations::get_max_size() << " bytes");
+    BOOST_TEST(allocations::get_max_size() <= 2 * SessionContext::DEFAULT_MAX_LINE_LENGTH);
+}
+
+BOOST_AUTO_TEST_CASE(test_long_line_in_parallel) {
+    // Long enough to be split into segments, and longer than the default
+    // limit.
+    static constexpr std::size_t NUMOF_TERMS = 32 * 1024;
+
+    const auto with_ones = [](const std::string& first, const std::string& last) {
+        std::string request{first};
+        for (std::size_t i = 0; i < NUMOF_TERMS; ++i) {
+            request += " + 1";
+        }
+        return request + last + '\n';
+    };
+
+    const auto evaluate = [](const std::string& request, std::size_t compute_threads) {
+        auto settings = test_server::make_settings();
+        // Buffering lines this long is opt-in.
+        settings.m_max_line_length = 4 * request.size();
+        settings.m_compute_threads = compute_threads;
+        RunningServer server{settings};
+        Client client{server.get_port()};
+        client.send(request);
+        return client.read_line();
+    };
+
+    // Evaluated in parallel, and exactly.
+    const auto exact = with_ones("2 * 3", "");
+    BOOST_TEST_REQUIRE(exact.size() > math::server::SessionContext::DEFAULT_MAX_LINE_LENGTH);
+    BOOST_TEST(evaluate(exact, 2) == std::to_string(NUMOF_TERMS + 6) + "\r\n");
+
+    // The ones are lost when they're added to 1e17 one by one, which is what
+    // Parser does, so the line isn't split.
+    const auto inexact = with_ones("1e17", " - 1e17");
+    BOOST_TEST(evaluate(inexact, 0) == "0\r\n");
+    BOOST_TEST(evaluate(inexact, 2) == "0\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(test_backpressure) {
+    // The replies are longer than the requests ("1; 1; ..."), but cheap to
+    // produce, so that the server could easily keep reading.
+    static constexpr std::size_t NUMOF_ITEMS = 1024;
+    static const std::string REQUEST = make_batch(NUMOF_ITEMS) + '\n';
+    static constexpr std::size_t MAX_SENT = 64 * 1024 * 1024;
+    static constexpr std::chrono::milliseconds STALL{500};
+
+    RunningServer server;
+    Client client{server.get_port()};
+
+    // The replies aren't read, so the server should stop reading requests
+    // after about MAX_PENDING_OUTPUT bytes of replies (plus whatever the
+    // sockets buffer).
+    std::atomic<std::size_t> sent{0};
+    std::thread writer{[&client, &sent]() {
+        try {
+            while (sent < MAX_SENT) {
+                client.send(REQUEST);
+                sent += REQUEST.size();
+            }
+        } catch (const boost::system::system_error&) {
+            // The connection is shut down below.
+        }
+    }};
+
+    std::size_t stalled_at = 0;
+    do {
+        stalled_at = sent;
+        std::this_thread::sleep_for(STALL);
+    } while (sent != stalled_at && sent < MAX_SENT);
+    // A server that never stops reading slows down eventually too, but only
+    // after reading almost everything.
+    BOOST_TEST(stalled_at < MAX_SENT / 2);
+
+    // Reading the replies lets the server read more requests.
+    for (std::size_t i = 0; i < 1000 && sent == stalled_at; ++i) {
+        const auto items = split_batch_reply(client.read_line());
+        BOOST_TEST_REQUIRE(items.size() == NUMOF_ITEMS);
+        BOOST_TEST_REQUIRE(items.back() == "1");
+    }
+    BOOST_TEST(sent > stalled_at);
+    BOOST_TEST_MESSAGE("Sent " << stalled_at << " bytes before the server stopped reading");
+
+    client.socket().shutdown(Client::Socket::shutdown_both);
+    writer.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
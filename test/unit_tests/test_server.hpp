@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Egor Tensin <Egor.Tensin@gmail.com>
+// This file is part of the "math-server" project.
+// For details, see https://github.com/egor-tensin/math-server.
+// Distributed under the MIT License.
+
+#pragma once
+
+#include <main/server.hpp>
+#include <main/settings.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace test_server {
+
+// A single IO thread, no cache and no compute threads, listening on a port
+// chosen by the OS.
+inline math::server::Settings make_settings() {
+    math::server::Settings settings;
+    settings.m_port = 0;
+    settings.m_threads = 1;
+    settings.m_cache_size = 0;
+    settings.m_compute_threads = 0;
+    return settings;
+}
+
+class RunningServer {
+public:
+    explicit RunningServer(const math::server::Settings& settings = make_settings())
+        : m_server{settings}, m_thread{[this]() { m_server.run(); }} {}
+
+    ~RunningServer() {
+        m_server.stop();
+        m_thread.join();
+    }
+
+    unsigned short get_port() const { return m_server.get_port(); }
+
+private:
+    math::server::Server m_server;
+    std::thread m_thread;
+};
+
+// A blocking client, over either TCP or a UNIX domain socket.
+class Client {
+public:
+    using Socket = boost::asio::generic::stream_protocol::socket;
+
+    explicit Client(unsigned short port) : m_socket{m_io_context} {
+        const boost::asio::ip::tcp::endpoint endpoint{boost::asio::ip::address_v4::loopback(),
+                                                      port};
+        m_socket.connect(endpoint);
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    explicit Client(const std::string& unix_socket) : m_socket{m_io_context} {
+        m_socket.connect(boost::asio::local::stream_protocol::endpoint{unix_socket});
+    }
+#endif
+
+    Socket& socket() { return m_socket; }
+
+    void send(std::string_view data) {
+        boost::asio::write(m_socket, boost::asio::buffer(data.data(), data.size()));
+    }
+
+    // No more requests; the server still replies to the ones it got.
+    void shutdown_send() { m_socket.shutdown(Socket::shutdown_send); }
+
+    // Includes the terminating CRLF.
+    std::string read_line() {
+        const auto bytes = boost::asio::read_until(m_socket, m_reply, '\n');
+        std::string line{boost::asio::buffer_cast<const char*>(m_reply.data()), bytes};
+        m_reply.consume(bytes);
+        return line;
+    }
+
+    std::string read(std::size_t n) {
+        if (m_reply.size() < n) {
+            boost::asio::read(m_socket, m_reply, boost::asio::transfer_exactly(n - m_reply.size()));
+        }
+        std::string data{boost::asio::buffer_cast<const char*>(m_reply.data()), n};
+        m_reply.consume(n);
+        return data;
+    }
+
+    // Reads everything the server sends before it closes the connection.
+    std::string read_all() {
+        boost::system::error_code ec;
+        boost::asio::read(m_socket, m_reply, ec);
+        std::string data{boost::asio::buffer_cast<const char*>(m_reply.data()), m_reply.size()};
+        m_reply.consume(m_reply.size());
+        return data;
+    }
+
+    // Doesn't allocate memory itself.
+    bool round_trip(std::string_view request, std::string_view reply) {
+        send(request);
+        const auto bytes = boost::asio::read_until(m_socket, m_reply, '\n');
+        const auto data = boost::asio::buffer_cast<const char*>(m_reply.data());
+        const auto ok = std::string_view{data, bytes} == reply;
+        m_reply.consume(bytes);
+        return ok;
+    }
+
+private:
+    boost::asio::io_context m_io_context;
+    Socket m_socket;
+    boost::asio::streambuf m_reply;
+};
+
+} // namespace test_server